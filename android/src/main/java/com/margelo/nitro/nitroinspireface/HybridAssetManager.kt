@@ -2,7 +2,11 @@ package com.margelo.nitro.nitroinspireface
 
 import com.facebook.proguard.annotations.DoNotStrip
 import android.content.Context
+import android.graphics.Bitmap
+import android.graphics.BitmapFactory
 import com.margelo.nitro.NitroModules
+import com.margelo.nitro.core.ArrayBuffer
+import java.io.ByteArrayOutputStream
 import java.io.File
 import java.io.FileOutputStream
 import java.io.IOException
@@ -45,4 +49,78 @@ class HybridAssetManager : HybridAssetManagerSpec() {
       throw Error("Asset '$assetPath' does not exist")
     }
   }
+
+  override fun decodeImage(buffer: ArrayBuffer, maxSize: Double?): DecodedImage {
+    val source = buffer.getBuffer(false).duplicate()
+    val bytes = ByteArray(source.remaining())
+    source.get(bytes)
+
+    val options = BitmapFactory.Options()
+    options.inJustDecodeBounds = true
+    BitmapFactory.decodeByteArray(bytes, 0, bytes.size, options)
+    if (options.outWidth <= 0 || options.outHeight <= 0) {
+      throw Error("Unsupported or corrupt image data")
+    }
+
+    // The JPEG decoder applies power of two sample sizes while decoding the DCT blocks
+    var sampleSize = 1
+    if (maxSize != null && maxSize > 0) {
+      val longest = maxOf(options.outWidth, options.outHeight)
+      while (longest / (sampleSize * 2) >= maxSize) {
+        sampleSize *= 2
+      }
+    }
+    options.inJustDecodeBounds = false
+    options.inSampleSize = sampleSize
+    options.inPreferredConfig = Bitmap.Config.ARGB_8888
+    options.inPremultiplied = false
+
+    val bitmap = BitmapFactory.decodeByteArray(bytes, 0, bytes.size, options)
+      ?: throw Error("Failed to decode image data")
+    try {
+      val pixels = ArrayBuffer.allocate(bitmap.width * bitmap.height * 4)
+      bitmap.copyPixelsToBuffer(pixels.getBuffer(false))
+      return DecodedImage(pixels, bitmap.width.toDouble(), bitmap.height.toDouble())
+    } finally {
+      bitmap.recycle()
+    }
+  }
+
+  override fun encodeImage(
+    data: ArrayBuffer,
+    width: Double,
+    height: Double,
+    format: ImageEncoding,
+    quality: Double
+  ): ArrayBuffer {
+    val w = width.toInt()
+    val h = height.toInt()
+    val pixels = data.getBuffer(false).duplicate()
+    if (w <= 0 || h <= 0 || pixels.remaining() != w * h * 4) {
+      throw Error("Invalid image data")
+    }
+
+    val bitmap = Bitmap.createBitmap(w, h, Bitmap.Config.ARGB_8888)
+    try {
+      // The pixels are straight RGBA, keep PNG alpha as it is
+      bitmap.setPremultiplied(false)
+      bitmap.copyPixelsFromBuffer(pixels)
+
+      val compressFormat = when (format) {
+        ImageEncoding.JPEG -> Bitmap.CompressFormat.JPEG
+        ImageEncoding.PNG -> Bitmap.CompressFormat.PNG
+      }
+      val output = ByteArrayOutputStream(w * h / 4)
+      if (!bitmap.compress(compressFormat, quality.toInt(), output)) {
+        throw Error("Failed to encode image data")
+      }
+
+      val bytes = output.toByteArray()
+      val encoded = ArrayBuffer.allocate(bytes.size)
+      encoded.getBuffer(false).put(bytes)
+      return encoded
+    } finally {
+      bitmap.recycle()
+    }
+  }
 }
@@ -0,0 +1,92 @@
+#include "AdaptiveTrackController.hpp"
+#include <algorithm>
+
+namespace margelo::nitro::nitroinspireface
+{
+  namespace
+  {
+    constexpr double kSmoothing = 0.2;
+    // Let a change settle before judging it
+    constexpr uint32_t kAdjustPeriod = 15;
+    constexpr int32_t kPreviewStep = 32;
+    // Tracks started or ended per frame above which a scene counts as busy
+    constexpr double kBusyChurn = 0.1;
+    // Average number of tracked faces below which the scene counts as empty
+    constexpr double kEmptyScene = 0.5;
+  } // namespace
+
+  void AdaptiveTrackController::configure(double targetFrameTime, int32_t minDetectInterval, int32_t maxDetectInterval, int32_t minPreviewSize, int32_t maxPreviewSize, Settings initial)
+  {
+    _targetFrameTime = std::max(1.0, targetFrameTime);
+    _minDetectInterval = std::max(1, minDetectInterval);
+    _maxDetectInterval = std::max(_minDetectInterval, maxDetectInterval);
+    _minPreviewSize = std::max(kPreviewStep, minPreviewSize);
+    _maxPreviewSize = std::max(_minPreviewSize, maxPreviewSize);
+
+    reset(initial);
+    _frameTime = 0.0;
+    _churn = 0.0;
+    _faceCount = 0.0;
+    _frames = 0;
+  }
+
+  void AdaptiveTrackController::reset(Settings settings)
+  {
+    _settings.detectInterval = std::clamp(settings.detectInterval, _minDetectInterval, _maxDetectInterval);
+    _settings.previewSize = std::clamp(settings.previewSize, _minPreviewSize, _maxPreviewSize);
+  }
+
+  bool AdaptiveTrackController::record(double frameTime, int32_t faceCount, int32_t churn)
+  {
+    if (_frames == 0)
+    {
+      _frameTime = frameTime;
+      _faceCount = faceCount;
+    }
+    _frameTime += (frameTime - _frameTime) * kSmoothing;
+    _churn += (churn - _churn) * kSmoothing;
+    _faceCount += (faceCount - _faceCount) * kSmoothing;
+
+    if (++_frames % kAdjustPeriod != 0)
+    {
+      return false;
+    }
+
+    const bool busy = _churn > kBusyChurn;
+    if (_frameTime > _targetFrameTime * 1.1)
+    {
+      // Over budget: busy scenes give up preview resolution first, calm ones detect less often
+      return busy ? (stepPreviewSize(-1) || stepInterval(1)) : (stepInterval(1) || stepPreviewSize(-1));
+    }
+    if (_frameTime < _targetFrameTime * 0.7 && _faceCount >= kEmptyScene)
+    {
+      // Headroom: busy scenes detect more often first, calm ones get resolution back
+      return busy ? (stepInterval(-1) || stepPreviewSize(1)) : (stepPreviewSize(1) || stepInterval(-1));
+    }
+    return false;
+  }
+
+  bool AdaptiveTrackController::stepInterval(int32_t direction)
+  {
+    const int32_t step = std::max(1, _settings.detectInterval / 4);
+    const int32_t next = std::clamp(_settings.detectInterval + direction * step, _minDetectInterval, _maxDetectInterval);
+    if (next == _settings.detectInterval)
+    {
+      return false;
+    }
+    _settings.detectInterval = next;
+    return true;
+  }
+
+  bool AdaptiveTrackController::stepPreviewSize(int32_t direction)
+  {
+    const int32_t next = std::clamp(_settings.previewSize + direction * kPreviewStep, _minPreviewSize, _maxPreviewSize);
+    if (next == _settings.previewSize)
+    {
+      return false;
+    }
+    _settings.previewSize = next;
+    return true;
+  }
+
+} // namespace margelo::nitro::nitroinspireface
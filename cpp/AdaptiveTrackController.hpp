@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+
+namespace margelo::nitro::nitroinspireface
+{
+  /**
+   * Closed-loop tuning of the tracking knobs of a session.
+   *
+   * Frame times and scene dynamics are smoothed with an exponential moving
+   * average. Every few frames the detect interval and the preview size are
+   * moved one step within their bounds to hold the target frame time. Busy
+   * scenes, with tracks starting and ending, keep detection frequent and
+   * trade preview size first. Calm scenes do the opposite. Headroom measured
+   * while no face is in view is not spent, it is gone as soon as faces show up.
+   */
+  class AdaptiveTrackController
+  {
+  public:
+    struct Settings
+    {
+      int32_t detectInterval;
+      int32_t previewSize;
+    };
+
+    // Starts from the given settings, clamped into the bounds
+    void configure(double targetFrameTime, int32_t minDetectInterval, int32_t maxDetectInterval, int32_t minPreviewSize, int32_t maxPreviewSize, Settings initial);
+
+    // Continue from settings chosen by the caller, clamped into the bounds
+    void reset(Settings settings);
+
+    // Feed one tracked frame, returns true when the settings changed
+    bool record(double frameTime, int32_t faceCount, int32_t churn);
+
+    Settings settings() const { return _settings; }
+    double averageFrameTime() const { return _frameTime; }
+    double averageChurn() const { return _churn; }
+    double averageFaceCount() const { return _faceCount; }
+
+  private:
+    bool stepInterval(int32_t direction);
+    bool stepPreviewSize(int32_t direction);
+
+  private:
+    double _targetFrameTime = 33.0;
+    int32_t _minDetectInterval = 5;
+    int32_t _maxDetectInterval = 60;
+    int32_t _minPreviewSize = 128;
+    int32_t _maxPreviewSize = 320;
+
+    Settings _settings{20, 192};
+    double _frameTime = 0.0;
+    double _churn = 0.0;
+    double _faceCount = 0.0;
+    uint32_t _frames = 0;
+  };
+
+} // namespace margelo::nitro::nitroinspireface
@@ -0,0 +1,94 @@
+#include "BestShotSelector.hpp"
+#include <algorithm>
+#include <unordered_set>
+
+namespace margelo::nitro::nitroinspireface
+{
+  BestShotSelector::~BestShotSelector()
+  {
+    clear();
+  }
+
+  void BestShotSelector::configure(size_t count, float minScore)
+  {
+    _count = std::max<size_t>(1, count);
+    _minScore = minScore;
+
+    // Drop the shots that no longer fit the new count
+    for (auto &[trackId, shots] : _tracks)
+    {
+      while (shots.size() > _count)
+      {
+        HFReleaseImageBitmap(shots.back().bitmap);
+        shots.pop_back();
+      }
+    }
+  }
+
+  bool BestShotSelector::accepts(int32_t trackId, float score) const
+  {
+    if (score < _minScore)
+    {
+      return false;
+    }
+    auto it = _tracks.find(trackId);
+    if (it == _tracks.end() || it->second.size() < _count)
+    {
+      return true;
+    }
+    return score > it->second.back().score;
+  }
+
+  void BestShotSelector::offer(int32_t trackId, const Shot &shot)
+  {
+    auto &shots = _tracks[trackId];
+    auto position = std::upper_bound(shots.begin(), shots.end(), shot.score, [](float score, const Shot &other)
+                                     { return score > other.score; });
+    shots.insert(position, shot);
+    if (shots.size() > _count)
+    {
+      HFReleaseImageBitmap(shots.back().bitmap);
+      shots.pop_back();
+    }
+  }
+
+  std::vector<BestShotSelector::TrackShots> BestShotSelector::finish(const std::vector<int32_t> &aliveTrackIds)
+  {
+    std::vector<TrackShots> finished;
+    if (_tracks.empty())
+    {
+      return finished;
+    }
+
+    const std::unordered_set<int32_t> alive(aliveTrackIds.begin(), aliveTrackIds.end());
+    for (auto it = _tracks.begin(); it != _tracks.end();)
+    {
+      if (alive.count(it->first))
+      {
+        ++it;
+        continue;
+      }
+      finished.emplace_back(it->first, std::move(it->second));
+      it = _tracks.erase(it);
+    }
+    return finished;
+  }
+
+  std::vector<BestShotSelector::TrackShots> BestShotSelector::finishAll()
+  {
+    return finish({});
+  }
+
+  void BestShotSelector::clear()
+  {
+    for (auto &[trackId, shots] : _tracks)
+    {
+      for (auto &shot : shots)
+      {
+        HFReleaseImageBitmap(shot.bitmap);
+      }
+    }
+    _tracks.clear();
+  }
+
+} // namespace margelo::nitro::nitroinspireface
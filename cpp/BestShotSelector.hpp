@@ -0,0 +1,58 @@
+#pragma once
+
+#include "inspireface.h"
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace margelo::nitro::nitroinspireface
+{
+  /**
+   * Keeps the best aligned face crops of every active track.
+   *
+   * Only the top `count` frames of a track are kept, so memory stays bounded
+   * by the number of tracks on screen. The caller scores a frame first and
+   * only renders its aligned crop when `accepts` says it would be kept.
+   */
+  class BestShotSelector
+  {
+  public:
+    struct Shot
+    {
+      HFImageBitmap bitmap = nullptr;
+      float score = 0.0f;
+      float quality = 0.0f;
+      HFaceRect rect = {};
+      float roll = 0.0f;
+      float yaw = 0.0f;
+      float pitch = 0.0f;
+    };
+
+    using TrackShots = std::pair<int32_t, std::vector<Shot>>;
+
+    BestShotSelector() = default;
+    BestShotSelector(const BestShotSelector &) = delete;
+    BestShotSelector &operator=(const BestShotSelector &) = delete;
+    ~BestShotSelector();
+
+    void configure(size_t count, float minScore);
+
+    bool accepts(int32_t trackId, float score) const;
+    // Takes ownership of shot.bitmap
+    void offer(int32_t trackId, const Shot &shot);
+
+    // Remove the tracks missing from the latest tracking output, ownership of their bitmaps moves to the caller
+    std::vector<TrackShots> finish(const std::vector<int32_t> &aliveTrackIds);
+    std::vector<TrackShots> finishAll();
+    void clear();
+
+  private:
+    size_t _count = 3;
+    float _minScore = 0.0f;
+    // Shots of each track, best first
+    std::unordered_map<int32_t, std::vector<Shot>> _tracks;
+  };
+
+} // namespace margelo::nitro::nitroinspireface
@@ -0,0 +1,167 @@
+#include "CascadeDetector.hpp"
+#include "ImageKernels.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+namespace margelo::nitro::nitroinspireface
+{
+  namespace
+  {
+    double elapsedSince(std::chrono::steady_clock::time_point start)
+    {
+      return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+  } // namespace
+
+  CascadeDetector::~CascadeDetector()
+  {
+    release();
+  }
+
+  void CascadeDetector::configure(int32_t coarseSize, int32_t detectPixelLevel, int32_t maxDetectFaceNum, float margin, float iouThreshold)
+  {
+    // Only the detector is needed, every other module stays unloaded
+    HFSessionCustomParameter hfParam = {};
+    HFSession session = nullptr;
+    HResult result = HFCreateInspireFaceSession(
+        hfParam,
+        HF_DETECT_MODE_ALWAYS_DETECT,
+        static_cast<HInt32>(maxDetectFaceNum),
+        static_cast<HInt32>(detectPixelLevel),
+        -1,
+        &session);
+    if (result != HSUCCEED || session == nullptr)
+    {
+      throw std::runtime_error("Failed to create session with error code: " + std::to_string(result));
+    }
+
+    release();
+    _session = session;
+    _coarseSize = std::max<int32_t>(32, coarseSize);
+    _margin = std::max(0.0f, margin);
+    _iouThreshold = iouThreshold;
+  }
+
+  void CascadeDetector::release()
+  {
+    if (_session != nullptr)
+    {
+      HFReleaseInspireFaceSession(_session);
+      _session = nullptr;
+    }
+    _coarseBuffer.clear();
+    _coarseBuffer.shrink_to_fit();
+    _cropBuffer.clear();
+    _cropBuffer.shrink_to_fit();
+  }
+
+  void CascadeDetector::detectImage(const uint8_t *data, int32_t width, int32_t height, float scale, float offsetX, float offsetY,
+                                    std::vector<Detection> &detections)
+  {
+    HFImageData image = {};
+    image.data = const_cast<uint8_t *>(data);
+    image.width = width;
+    image.height = height;
+    image.format = HF_STREAM_BGR;
+    image.rotation = HF_CAMERA_ROTATION_0;
+
+    HFImageStream stream = nullptr;
+    HResult result = HFCreateImageStream(&image, &stream);
+    if (result != HSUCCEED)
+    {
+      throw std::runtime_error("Failed to create image stream with error code: " + std::to_string(result));
+    }
+    HFMultipleFaceData faces = {};
+    result = HFExecuteFaceTrack(_session, stream, &faces);
+    if (result == HSUCCEED)
+    {
+      for (int i = 0; i < faces.detectedNum; i++)
+      {
+        detections.push_back({
+            faces.rects[i].x * scale + offsetX,
+            faces.rects[i].y * scale + offsetY,
+            faces.rects[i].width * scale,
+            faces.rects[i].height * scale,
+            faces.detConfidence[i],
+            faces.angles.roll[i],
+            faces.angles.yaw[i],
+            faces.angles.pitch[i],
+        });
+      }
+    }
+    HFReleaseImageStream(stream);
+    if (result != HSUCCEED)
+    {
+      throw std::runtime_error("Failed to detect faces with error code: " + std::to_string(result));
+    }
+  }
+
+  std::vector<Detection> CascadeDetector::detect(const uint8_t *data, int32_t width, int32_t height)
+  {
+    if (_session == nullptr)
+    {
+      throw std::runtime_error("Coarse-to-fine detection is not configured");
+    }
+
+    // Coarse stage, frames already small enough are detected as they are
+    auto start = std::chrono::steady_clock::now();
+    std::vector<Detection> candidates;
+    const float shrink = static_cast<float>(_coarseSize) / static_cast<float>(std::max(width, height));
+    if (shrink < 1.0f)
+    {
+      const int32_t coarseWidth = std::max<int32_t>(1, static_cast<int32_t>(std::lround(width * shrink)));
+      const int32_t coarseHeight = std::max<int32_t>(1, static_cast<int32_t>(std::lround(height * shrink)));
+      _coarseBuffer.resize(static_cast<size_t>(coarseWidth) * coarseHeight * 3);
+      resizeImage(data, width, height, 3, _coarseBuffer.data(), coarseWidth, coarseHeight);
+      detectImage(_coarseBuffer.data(), coarseWidth, coarseHeight,
+                  static_cast<float>(width) / coarseWidth, 0.0f, 0.0f, candidates);
+    }
+    else
+    {
+      detectImage(data, width, height, 1.0f, 0.0f, 0.0f, candidates);
+    }
+    _coarseTime = elapsedSince(start);
+    _candidateCount = candidates.size();
+    if (shrink >= 1.0f)
+    {
+      // The coarse pass already ran at full resolution, there is nothing to refine
+      _fineTime = 0.0;
+      return candidates;
+    }
+
+    // Fine stage, the detector upscales every crop to its own input size
+    start = std::chrono::steady_clock::now();
+    std::vector<Detection> detections;
+    const size_t stride = static_cast<size_t>(width) * 3;
+    for (const auto &candidate : candidates)
+    {
+      const float pad = std::max(candidate.width, candidate.height) * _margin;
+      const int32_t left = std::max<int32_t>(0, static_cast<int32_t>(std::floor(candidate.x - pad)));
+      const int32_t top = std::max<int32_t>(0, static_cast<int32_t>(std::floor(candidate.y - pad)));
+      const int32_t right = std::min<int32_t>(width, static_cast<int32_t>(std::ceil(candidate.x + candidate.width + pad)));
+      const int32_t bottom = std::min<int32_t>(height, static_cast<int32_t>(std::ceil(candidate.y + candidate.height + pad)));
+      if (right - left < 16 || bottom - top < 16)
+      {
+        continue;
+      }
+
+      const uint8_t *crop = data + static_cast<size_t>(top) * stride;
+      if (right - left != width)
+      {
+        _cropBuffer.resize(static_cast<size_t>(right - left) * (bottom - top) * 3);
+        copyRegion(data, width, 3, left, top, right - left, bottom - top, _cropBuffer.data());
+        crop = _cropBuffer.data();
+      }
+      detectImage(crop, right - left, bottom - top, 1.0f, static_cast<float>(left), static_cast<float>(top), detections);
+    }
+
+    // Crops of nearby candidates overlap and find the same faces
+    nonMaxSuppression(detections, _iouThreshold);
+    _fineTime = elapsedSince(start);
+    return detections;
+  }
+
+} // namespace margelo::nitro::nitroinspireface
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "DetectionMerge.hpp"
+#include "inspireface.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace margelo::nitro::nitroinspireface
+{
+  /**
+   * Two-stage face detection for large frames.
+   *
+   * The coarse stage detects on a downscaled copy of the frame, which is much
+   * cheaper than letting the detector shrink the full frame. The fine stage
+   * crops a margin around every candidate from the full frame and detects again
+   * on the crop, so small faces are located at the resolution of the source.
+   * Candidates the fine stage does not confirm are dropped.
+   *
+   * Owns a detect-only session, separate from any tracking session.
+   */
+  class CascadeDetector
+  {
+  public:
+    ~CascadeDetector();
+
+    // Create the detect session, replaces the previous one
+    void configure(int32_t coarseSize, int32_t detectPixelLevel, int32_t maxDetectFaceNum, float margin, float iouThreshold);
+    bool configured() const { return _session != nullptr; }
+
+    // Detect on a 3 channel BGR frame, detections are in frame coordinates
+    std::vector<Detection> detect(const uint8_t *data, int32_t width, int32_t height);
+    size_t candidateCount() const { return _candidateCount; }
+    double coarseTime() const { return _coarseTime; }
+    double fineTime() const { return _fineTime; }
+    void release();
+
+  private:
+    // Detect on a packed BGR image and append the faces, scaled then offset
+    void detectImage(const uint8_t *data, int32_t width, int32_t height, float scale, float offsetX, float offsetY,
+                     std::vector<Detection> &detections);
+
+  private:
+    HFSession _session = nullptr;
+    int32_t _coarseSize = 320;
+    float _margin = 0.5f;
+    float _iouThreshold = 0.4f;
+
+    std::vector<uint8_t> _coarseBuffer;
+    std::vector<uint8_t> _cropBuffer;
+    size_t _candidateCount = 0;
+    double _coarseTime = 0.0;
+    double _fineTime = 0.0;
+  };
+
+} // namespace margelo::nitro::nitroinspireface
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+namespace margelo::nitro::nitroinspireface
+{
+  /**
+   * Face found by one of several detection passes, in full-frame coordinates.
+   */
+  struct Detection
+  {
+    float x;
+    float y;
+    float width;
+    float height;
+    float confidence;
+    float roll;
+    float yaw;
+    float pitch;
+  };
+
+  /**
+   * Greedy non-max suppression, keeps the most confident of overlapping detections.
+   * When one box lies mostly inside another, which is what a face cut by a tile or crop
+   * border looks like next to the full face, the larger box is kept whatever the order,
+   * with the higher of the two confidences.
+   */
+  inline void nonMaxSuppression(std::vector<Detection> &detections, float iouThreshold, float containThreshold = 0.8f)
+  {
+    std::stable_sort(detections.begin(), detections.end(), [](const Detection &a, const Detection &b)
+                     { return a.confidence > b.confidence; });
+
+    std::vector<Detection> kept;
+    kept.reserve(detections.size());
+    std::vector<size_t> inside;
+    for (const auto &candidate : detections)
+    {
+      const float candidateArea = candidate.width * candidate.height;
+      bool suppressed = false;
+      inside.clear();
+      for (size_t k = 0; k < kept.size(); k++)
+      {
+        const Detection &face = kept[k];
+        const float left = std::max(candidate.x, face.x);
+        const float top = std::max(candidate.y, face.y);
+        const float right = std::min(candidate.x + candidate.width, face.x + face.width);
+        const float bottom = std::min(candidate.y + candidate.height, face.y + face.height);
+        const float intersection = std::max(0.0f, right - left) * std::max(0.0f, bottom - top);
+        if (intersection <= 0.0f)
+        {
+          continue;
+        }
+        const float faceArea = face.width * face.height;
+        const float iou = intersection / (candidateArea + faceArea - intersection);
+        const float contained = intersection / std::max(1.0f, std::min(candidateArea, faceArea));
+        if (iou > iouThreshold || (contained > containThreshold && candidateArea <= faceArea))
+        {
+          suppressed = true;
+          break;
+        }
+        if (contained > containThreshold)
+        {
+          inside.push_back(k);
+        }
+      }
+      if (suppressed)
+      {
+        continue;
+      }
+      if (inside.empty())
+      {
+        kept.push_back(candidate);
+        continue;
+      }
+
+      // The candidate is the full face of kept partial ones, it takes the place of the first
+      Detection merged = candidate;
+      merged.confidence = kept[inside.front()].confidence;
+      kept[inside.front()] = merged;
+      for (size_t i = inside.size() - 1; i > 0; i--)
+      {
+        kept.erase(kept.begin() + static_cast<std::ptrdiff_t>(inside[i]));
+      }
+    }
+    detections.swap(kept);
+  }
+
+} // namespace margelo::nitro::nitroinspireface
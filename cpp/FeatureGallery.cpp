@@ -0,0 +1,646 @@
+#include "FeatureGallery.hpp"
+#include "FeatureMath.hpp"
+#include "inspireface.h"
+#include <NitroModules/NitroLogger.hpp>
+#include <sys/stat.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+namespace margelo::nitro::nitroinspireface
+{
+  namespace
+  {
+    constexpr const char *TAG = "FeatureGallery";
+    constexpr size_t kCropHeaderSize = 3 * sizeof(int32_t);
+  } // namespace
+
+  FeatureGallery &FeatureGallery::shared()
+  {
+    static FeatureGallery instance;
+    return instance;
+  }
+
+  FeatureGallery::~FeatureGallery()
+  {
+    {
+      std::lock_guard<std::mutex> lock(_orderMutex);
+      _stopping = true;
+    }
+    _orderChanged.notify_one();
+    // The writer flushes a pending order before it exits
+    if (_orderWriter.joinable())
+    {
+      _orderWriter.join();
+    }
+  }
+
+  void FeatureGallery::setModelTag(const std::string &tag)
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _modelTag = tag;
+  }
+
+  std::string FeatureGallery::getModelTag()
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _modelTag;
+  }
+
+  void FeatureGallery::open(const std::string &basePath, bool persistent)
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _basePath = basePath;
+    _persistent = persistent;
+    _tags.clear();
+    _memoryCrops.clear();
+
+    if (_persistent)
+    {
+      mkdir((_basePath + ".crops").c_str(), 0755);
+      load();
+      // Compact the change log into one record per id
+      save();
+    }
+  }
+
+  void FeatureGallery::close()
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _tags.clear();
+    _memoryCrops.clear();
+    _basePath.clear();
+    _persistent = false;
+    _frequencyOrdering = false;
+    _featureLength = 0;
+    _matrix.clear();
+    _ids.clear();
+    _hits.clear();
+    _rows.clear();
+  }
+
+  void FeatureGallery::tag(int64_t id)
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _tags[id] = _modelTag;
+    appendRecords(std::to_string(id) + '\t' + _modelTag + '\n');
+  }
+
+  void FeatureGallery::tag(const std::vector<int64_t> &ids, const std::string &modelTag)
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::string records;
+    for (int64_t id : ids)
+    {
+      _tags[id] = modelTag;
+      records += std::to_string(id) + '\t' + modelTag + '\n';
+    }
+    appendRecords(records);
+  }
+
+  void FeatureGallery::erase(int64_t id)
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _tags.erase(id);
+    _memoryCrops.erase(id);
+    eraseFeature(id);
+    if (_persistent)
+    {
+      std::remove(cropPath(id).c_str());
+    }
+    // A record without a model tag removes the id
+    appendRecords(std::to_string(id) + '\n');
+  }
+
+  std::optional<std::string> FeatureGallery::getTag(int64_t id)
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto it = _tags.find(id);
+    if (it == _tags.end())
+    {
+      return std::nullopt;
+    }
+    return it->second;
+  }
+
+  std::vector<int64_t> FeatureGallery::getStaleIds()
+  {
+    std::lock_guard<std::mutex> hubLock(_hubMutex);
+    HFFeatureHubExistingIds existing = {};
+    if (HFFeatureHubGetExistingIds(&existing) != HSUCCEED)
+    {
+      Logger::log(LogLevel::Error, TAG, "Failed to read FeatureHub ids");
+      return {};
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::vector<int64_t> ids;
+    for (int i = 0; i < existing.size; i++)
+    {
+      // Features stored before tagging existed have no tag and count as stale
+      auto it = _tags.find(static_cast<int64_t>(existing.ids[i]));
+      if (it == _tags.end() || it->second != _modelTag)
+      {
+        ids.push_back(static_cast<int64_t>(existing.ids[i]));
+      }
+    }
+    return ids;
+  }
+
+  bool FeatureGallery::saveCrop(int64_t id, const uint8_t *data, int32_t width, int32_t height, int32_t channels)
+  {
+    if (data == nullptr || width <= 0 || height <= 0 || channels <= 0)
+    {
+      return false;
+    }
+
+    const size_t pixelSize = static_cast<size_t>(width) * static_cast<size_t>(height) * static_cast<size_t>(channels);
+    std::vector<uint8_t> record(kCropHeaderSize + pixelSize);
+    const int32_t header[3] = {width, height, channels};
+    std::memcpy(record.data(), header, kCropHeaderSize);
+    std::memcpy(record.data() + kCropHeaderSize, data, pixelSize);
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (!_persistent)
+    {
+      _memoryCrops[id] = std::move(record);
+      return true;
+    }
+
+    std::ofstream file(cropPath(id), std::ios::binary | std::ios::trunc);
+    if (!file)
+    {
+      Logger::log(LogLevel::Error, TAG, "Failed to open crop file for id %lld", static_cast<long long>(id));
+      return false;
+    }
+    file.write(reinterpret_cast<const char *>(record.data()), static_cast<std::streamsize>(record.size()));
+    return file.good();
+  }
+
+  bool FeatureGallery::loadCrop(int64_t id, std::vector<uint8_t> &data, int32_t &width, int32_t &height, int32_t &channels)
+  {
+    std::vector<uint8_t> record;
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      if (!_persistent)
+      {
+        auto it = _memoryCrops.find(id);
+        if (it == _memoryCrops.end())
+        {
+          return false;
+        }
+        record = it->second;
+      }
+      else
+      {
+        std::ifstream file(cropPath(id), std::ios::binary);
+        if (!file)
+        {
+          return false;
+        }
+        record.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+      }
+    }
+
+    if (record.size() < kCropHeaderSize)
+    {
+      return false;
+    }
+
+    int32_t header[3];
+    std::memcpy(header, record.data(), kCropHeaderSize);
+    width = header[0];
+    height = header[1];
+    channels = header[2];
+
+    const size_t pixelSize = static_cast<size_t>(width) * static_cast<size_t>(height) * static_cast<size_t>(channels);
+    if (width <= 0 || height <= 0 || channels <= 0 || record.size() != kCropHeaderSize + pixelSize)
+    {
+      Logger::log(LogLevel::Error, TAG, "Corrupt crop record for id %lld", static_cast<long long>(id));
+      return false;
+    }
+
+    data.assign(record.begin() + kCropHeaderSize, record.end());
+    return true;
+  }
+
+  bool FeatureGallery::hasCrop(int64_t id)
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (!_persistent)
+    {
+      return _memoryCrops.count(id) > 0;
+    }
+    struct stat info;
+    return stat(cropPath(id).c_str(), &info) == 0;
+  }
+
+  std::string FeatureGallery::getCheckpointPath()
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    // Without persistence the gallery does not survive a restart, so neither should the checkpoint
+    return _persistent ? _basePath + ".migration" : std::string();
+  }
+
+  void FeatureGallery::configureSearch(bool frequencyOrdering, bool eager, float threshold, int32_t reorderInterval)
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    // EXHAUSTIVE searches always visit every id, so the scan order only matters in EAGER mode
+    _frequencyOrdering = frequencyOrdering && eager;
+    _searchThreshold = threshold;
+    _reorderInterval = std::max<int32_t>(1, reorderInterval);
+    _searchesSinceReorder = 0;
+    // The mirror is filled lazily on the first search, the model may not be launched yet
+    _featureLength = 0;
+    _matrix.clear();
+    _ids.clear();
+    _hits.clear();
+    _rows.clear();
+  }
+
+  void FeatureGallery::setSearchThreshold(float threshold)
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _searchThreshold = threshold;
+  }
+
+  float FeatureGallery::getSearchThreshold()
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _searchThreshold;
+  }
+
+  bool FeatureGallery::isFrequencyOrdered()
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _frequencyOrdering;
+  }
+
+  void FeatureGallery::putFeature(int64_t id, const float *feature, int32_t length)
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (!_frequencyOrdering || _featureLength == 0 || length != _featureLength)
+    {
+      // Not mirrored yet, the next search loads it from the FeatureHub
+      return;
+    }
+
+    auto it = _rows.find(id);
+    if (it == _rows.end())
+    {
+      // New ids start at the back of the scan order
+      _rows[id] = _ids.size();
+      _ids.push_back(id);
+      _hits.push_back(0);
+      _matrix.insert(_matrix.end(), feature, feature + length);
+      it = _rows.find(id);
+    }
+    else
+    {
+      std::copy(feature, feature + length, _matrix.begin() + it->second * _featureLength);
+    }
+    l2Normalize(_matrix.data() + it->second * _featureLength, _featureLength);
+  }
+
+  bool FeatureGallery::searchEager(const float *query, int32_t length, int64_t &id, float &confidence, std::vector<float> &feature)
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_featureLength == 0)
+    {
+      loadFeatures();
+    }
+    if (length != _featureLength)
+    {
+      return false;
+    }
+
+    std::vector<float> normalized(query, query + length);
+    l2Normalize(normalized.data(), length);
+
+    bool found = false;
+    for (size_t row = 0; row < _ids.size(); row++)
+    {
+      const float *candidate = _matrix.data() + row * _featureLength;
+      const float similarity = dotProduct(normalized.data(), candidate, _featureLength);
+      if (similarity >= _searchThreshold)
+      {
+        _hits[row]++;
+        id = _ids[row];
+        confidence = similarity;
+        found = true;
+        break;
+      }
+    }
+
+    if (++_searchesSinceReorder >= _reorderInterval)
+    {
+      reorder(true);
+    }
+
+    // The mirror only holds normalized copies, return the feature the way it was stored
+    HFFaceFeatureIdentity identity = {};
+    if (found && HFFeatureHubGetFaceIdentity(static_cast<HFaceId>(id), &identity) == HSUCCEED && identity.feature)
+    {
+      feature.assign(identity.feature->data, identity.feature->data + identity.feature->size);
+    }
+    return found;
+  }
+
+  bool FeatureGallery::search(const float *query, int32_t length, int64_t &id, float &confidence)
+  {
+    id = -1;
+    confidence = 0.0f;
+    if (isFrequencyOrdered())
+    {
+      std::vector<float> feature;
+      return searchEager(query, length, id, confidence, feature);
+    }
+
+    HFFaceFeature hfFeature;
+    hfFeature.size = length;
+    hfFeature.data = const_cast<float *>(query);
+
+    HFloat hfConfidence = 0.0f;
+    HFFaceFeatureIdentity identity = {};
+    if (HFFeatureHubFaceSearch(hfFeature, &hfConfidence, &identity) != HSUCCEED || identity.id < 0)
+    {
+      return false;
+    }
+    id = static_cast<int64_t>(identity.id);
+    confidence = hfConfidence;
+    return true;
+  }
+
+  bool FeatureGallery::snapshotFeatures(std::vector<int64_t> &ids, std::vector<float> &matrix, int32_t &length)
+  {
+    ids.clear();
+    matrix.clear();
+    length = 0;
+
+    HInt32 featureLength = 0;
+    if (HFGetFeatureLength(&featureLength) != HSUCCEED || featureLength <= 0)
+    {
+      return false;
+    }
+
+    HFFeatureHubExistingIds existing = {};
+    if (HFFeatureHubGetExistingIds(&existing) != HSUCCEED)
+    {
+      Logger::log(LogLevel::Error, TAG, "Failed to read FeatureHub ids");
+      return false;
+    }
+
+    length = featureLength;
+    ids.reserve(existing.size);
+    matrix.reserve(static_cast<size_t>(existing.size) * featureLength);
+    for (int i = 0; i < existing.size; i++)
+    {
+      HFFaceFeatureIdentity identity = {};
+      if (HFFeatureHubGetFaceIdentity(existing.ids[i], &identity) != HSUCCEED || !identity.feature ||
+          identity.feature->size != featureLength)
+      {
+        continue;
+      }
+      ids.push_back(static_cast<int64_t>(existing.ids[i]));
+      matrix.insert(matrix.end(), identity.feature->data, identity.feature->data + featureLength);
+      l2Normalize(matrix.data() + (ids.size() - 1) * featureLength, featureLength);
+    }
+    return true;
+  }
+
+  void FeatureGallery::loadFeatures()
+  {
+    std::vector<int64_t> ids;
+    std::vector<float> matrix;
+    int32_t featureLength = 0;
+    if (!snapshotFeatures(ids, matrix, featureLength))
+    {
+      return;
+    }
+
+    // Restore the hit counters of the previous run
+    std::unordered_map<int64_t, uint32_t> persistedHits;
+    if (_persistent)
+    {
+      std::ifstream file(_basePath + ".order");
+      int64_t id = 0;
+      uint32_t hits = 0;
+      while (file >> id >> hits)
+      {
+        persistedHits[id] = hits;
+      }
+    }
+
+    _featureLength = featureLength;
+    _matrix = std::move(matrix);
+    _ids = std::move(ids);
+    _hits.assign(_ids.size(), 0);
+    _rows.clear();
+    for (size_t row = 0; row < _ids.size(); row++)
+    {
+      auto hits = persistedHits.find(_ids[row]);
+      if (hits != persistedHits.end())
+      {
+        _hits[row] = hits->second;
+      }
+      _rows[_ids[row]] = row;
+    }
+
+    // Apply the persisted order right away instead of waiting for the first reorder
+    reorder(false);
+    Logger::log(LogLevel::Info, TAG, "Mirrored %zu features for frequency-ordered search", _ids.size());
+  }
+
+  void FeatureGallery::eraseFeature(int64_t id)
+  {
+    auto it = _rows.find(id);
+    if (it == _rows.end())
+    {
+      return;
+    }
+
+    const size_t row = it->second;
+    _matrix.erase(_matrix.begin() + row * _featureLength, _matrix.begin() + (row + 1) * _featureLength);
+    _ids.erase(_ids.begin() + row);
+    _hits.erase(_hits.begin() + row);
+    _rows.erase(it);
+    for (size_t i = row; i < _ids.size(); i++)
+    {
+      _rows[_ids[i]] = i;
+    }
+  }
+
+  void FeatureGallery::reorder(bool decay)
+  {
+    _searchesSinceReorder = 0;
+
+    std::vector<size_t> order(_ids.size());
+    for (size_t i = 0; i < order.size(); i++)
+    {
+      order[i] = i;
+    }
+    // Stable, so ids with equal counts keep their relative order and the scan does not churn
+    std::stable_sort(order.begin(), order.end(), [this](size_t a, size_t b)
+                     { return _hits[a] > _hits[b]; });
+
+    std::vector<float> matrix(_matrix.size());
+    std::vector<int64_t> ids(_ids.size());
+    std::vector<uint32_t> hits(_hits.size());
+    for (size_t row = 0; row < order.size(); row++)
+    {
+      std::copy_n(_matrix.begin() + order[row] * _featureLength, _featureLength, matrix.begin() + row * _featureLength);
+      ids[row] = _ids[order[row]];
+      // Halve the counters so the order follows who shows up lately, not who showed up once
+      hits[row] = decay ? (_hits[order[row]] + 1) / 2 : _hits[order[row]];
+      _rows[ids[row]] = row;
+    }
+    _matrix = std::move(matrix);
+    _ids = std::move(ids);
+    _hits = std::move(hits);
+
+    saveOrder();
+  }
+
+  void FeatureGallery::saveOrder()
+  {
+    if (!_persistent)
+    {
+      return;
+    }
+
+    std::lock_guard<std::mutex> lock(_orderMutex);
+    _pendingOrderPath = _basePath + ".order";
+    _pendingOrder.resize(_ids.size());
+    for (size_t row = 0; row < _ids.size(); row++)
+    {
+      _pendingOrder[row] = {_ids[row], _hits[row]};
+    }
+    _orderPending = true;
+    if (!_orderWriter.joinable())
+    {
+      _orderWriter = std::thread(&FeatureGallery::writeOrders, this);
+    }
+    _orderChanged.notify_one();
+  }
+
+  void FeatureGallery::writeOrders()
+  {
+    std::unique_lock<std::mutex> lock(_orderMutex);
+    while (true)
+    {
+      _orderChanged.wait(lock, [this]()
+                         { return _orderPending || _stopping; });
+      if (!_orderPending)
+      {
+        return;
+      }
+      const std::string path = std::move(_pendingOrderPath);
+      const std::vector<std::pair<int64_t, uint32_t>> order = std::move(_pendingOrder);
+      _pendingOrder.clear();
+      _orderPending = false;
+      lock.unlock();
+
+      const std::string tmpPath = path + ".tmp";
+      {
+        std::ofstream file(tmpPath, std::ios::trunc);
+        if (!file)
+        {
+          Logger::log(LogLevel::Error, TAG, "Failed to write scan order to '%s'", tmpPath.c_str());
+          lock.lock();
+          continue;
+        }
+        for (const auto &[id, hits] : order)
+        {
+          file << id << '\t' << hits << '\n';
+        }
+      }
+      std::rename(tmpPath.c_str(), path.c_str());
+      lock.lock();
+    }
+  }
+
+  std::string FeatureGallery::cropPath(int64_t id) const
+  {
+    return _basePath + ".crops/" + std::to_string(id) + ".crop";
+  }
+
+  void FeatureGallery::load()
+  {
+    std::ifstream file(_basePath + ".meta");
+    if (!file)
+    {
+      return;
+    }
+
+    std::string line;
+    while (std::getline(file, line))
+    {
+      // A last line without its newline is a record cut short by a crash
+      if (file.eof())
+      {
+        break;
+      }
+      const size_t separator = line.find('\t');
+      try
+      {
+        if (separator == std::string::npos)
+        {
+          _tags.erase(std::stoll(line));
+        }
+        else
+        {
+          _tags[std::stoll(line.substr(0, separator))] = line.substr(separator + 1);
+        }
+      }
+      catch (const std::exception &e)
+      {
+        Logger::log(LogLevel::Warning, TAG, "Skipping malformed metadata line: %s", line.c_str());
+      }
+    }
+  }
+
+  void FeatureGallery::appendRecords(const std::string &records)
+  {
+    if (!_persistent)
+    {
+      return;
+    }
+
+    // One append per change, the full table is only rewritten when the gallery is opened
+    std::ofstream file(_basePath + ".meta", std::ios::app);
+    if (!file)
+    {
+      Logger::log(LogLevel::Error, TAG, "Failed to append metadata to '%s.meta'", _basePath.c_str());
+      return;
+    }
+    file << records;
+  }
+
+  void FeatureGallery::save()
+  {
+    if (!_persistent)
+    {
+      return;
+    }
+
+    // Write to a temporary file first so a crash never leaves a truncated table behind
+    const std::string path = _basePath + ".meta";
+    const std::string tmpPath = path + ".tmp";
+    {
+      std::ofstream file(tmpPath, std::ios::trunc);
+      if (!file)
+      {
+        Logger::log(LogLevel::Error, TAG, "Failed to write metadata to '%s'", tmpPath.c_str());
+        return;
+      }
+      for (const auto &[id, modelTag] : _tags)
+      {
+        file << id << '\t' << modelTag << '\n';
+      }
+    }
+    std::rename(tmpPath.c_str(), path.c_str());
+  }
+
+} // namespace margelo::nitro::nitroinspireface
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace margelo::nitro::nitroinspireface
+{
+  /**
+   * Process-wide bookkeeping that lives next to the FeatureHub.
+   *
+   * FeatureHub only stores feature vectors, so this keeps track of which model
+   * pack produced each stored feature and where its aligned face crop lives.
+   * When FeatureHub persistence is enabled the records are written next to the
+   * database file (`<db>.meta`, `<db>.crops/`, `<db>.order`). `<db>.meta` is a
+   * change log, appended to on every change and compacted when opened.
+   *
+   * With frequency ordering enabled it also mirrors the stored features and
+   * answers EAGER searches itself, scanning the most frequently matched ids
+   * first so the common case stops after a handful of comparisons. The scan
+   * order is written to disk on a background thread, searches never wait for it.
+   */
+  class FeatureGallery
+  {
+  public:
+    static FeatureGallery &shared();
+
+    // Serializes FeatureHub access against bulk operations such as migration
+    std::mutex &hubMutex() { return _hubMutex; }
+
+    // Model pack that produces newly extracted features
+    void setModelTag(const std::string &tag);
+    std::string getModelTag();
+
+    // Storage lifecycle, mirrors featureHubDataEnable / featureHubDataDisable
+    void open(const std::string &basePath, bool persistent);
+    void close();
+
+    // Per-id records
+    void tag(int64_t id);
+    void tag(const std::vector<int64_t> &ids, const std::string &modelTag);
+    void erase(int64_t id);
+    std::optional<std::string> getTag(int64_t id);
+    // FeatureHub ids not tagged with the current model pack, untagged ones included. Takes hubMutex
+    std::vector<int64_t> getStaleIds();
+
+    // Aligned face crops used to re-extract features after a model change
+    bool saveCrop(int64_t id, const uint8_t *data, int32_t width, int32_t height, int32_t channels);
+    bool loadCrop(int64_t id, std::vector<uint8_t> &data, int32_t &width, int32_t &height, int32_t &channels);
+    bool hasCrop(int64_t id);
+
+    // Path of the resumable migration checkpoint
+    std::string getCheckpointPath();
+
+    // Frequency-ordered EAGER search
+    void configureSearch(bool frequencyOrdering, bool eager, float threshold, int32_t reorderInterval);
+    void setSearchThreshold(float threshold);
+    bool isFrequencyOrdered();
+    void putFeature(int64_t id, const float *feature, int32_t length);
+    // feature receives the match as stored in the FeatureHub. The caller must hold hubMutex
+    bool searchEager(const float *query, int32_t length, int64_t &id, float &confidence, std::vector<float> &feature);
+    float getSearchThreshold();
+
+    // Best match of the FeatureHub, frequency-ordered when enabled. The caller must hold hubMutex
+    bool search(const float *query, int32_t length, int64_t &id, float &confidence);
+
+    // Normalized copy of every stored feature, the caller must hold hubMutex
+    bool snapshotFeatures(std::vector<int64_t> &ids, std::vector<float> &matrix, int32_t &length);
+
+  private:
+    FeatureGallery() = default;
+    ~FeatureGallery();
+
+    std::string cropPath(int64_t id) const;
+    void load();
+    void save();
+    void appendRecords(const std::string &records);
+    void loadFeatures();
+    void eraseFeature(int64_t id);
+    void reorder(bool decay);
+    void saveOrder();
+    void writeOrders();
+
+  private:
+    std::mutex _hubMutex;
+    std::mutex _mutex;
+    std::string _modelTag;
+    std::string _basePath;
+    bool _persistent = false;
+    std::unordered_map<int64_t, std::string> _tags;
+    // Crops are kept in memory when persistence is disabled
+    std::unordered_map<int64_t, std::vector<uint8_t>> _memoryCrops;
+
+    // Feature mirror in scan order, one row of `_featureLength` floats per id
+    bool _frequencyOrdering = false;
+    float _searchThreshold = 0.48f;
+    int32_t _reorderInterval = 256;
+    int32_t _searchesSinceReorder = 0;
+    int32_t _featureLength = 0;
+    std::vector<float> _matrix;
+    std::vector<int64_t> _ids;
+    std::vector<uint32_t> _hits;
+    std::unordered_map<int64_t, size_t> _rows;
+
+    // Latest scan order waiting for the writer thread, older ones are overwritten unwritten
+    std::thread _orderWriter;
+    std::mutex _orderMutex;
+    std::condition_variable _orderChanged;
+    std::string _pendingOrderPath;
+    std::vector<std::pair<int64_t, uint32_t>> _pendingOrder;
+    bool _orderPending = false;
+    bool _stopping = false;
+  };
+
+} // namespace margelo::nitro::nitroinspireface
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+namespace margelo::nitro::nitroinspireface
+{
+  /**
+   * Dot product of two feature vectors.
+   * For L2-normalized features this is the cosine similarity reported by HFFaceComparison.
+   */
+  inline float dotProduct(const float *a, const float *b, size_t length)
+  {
+    size_t i = 0;
+    float sum = 0.0f;
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    float32x4_t acc0 = vdupq_n_f32(0.0f);
+    float32x4_t acc1 = vdupq_n_f32(0.0f);
+    for (; i + 8 <= length; i += 8)
+    {
+      acc0 = vmlaq_f32(acc0, vld1q_f32(a + i), vld1q_f32(b + i));
+      acc1 = vmlaq_f32(acc1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+    }
+    float32x4_t acc = vaddq_f32(acc0, acc1);
+#if defined(__aarch64__)
+    sum = vaddvq_f32(acc);
+#else
+    float32x2_t pair = vadd_f32(vget_low_f32(acc), vget_high_f32(acc));
+    sum = vget_lane_f32(vpadd_f32(pair, pair), 0);
+#endif
+#else
+    // Independent accumulators let the compiler vectorize this loop
+    float acc[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    for (; i + 4 <= length; i += 4)
+    {
+      acc[0] += a[i] * b[i];
+      acc[1] += a[i + 1] * b[i + 1];
+      acc[2] += a[i + 2] * b[i + 2];
+      acc[3] += a[i + 3] * b[i + 3];
+    }
+    sum = (acc[0] + acc[1]) + (acc[2] + acc[3]);
+#endif
+    for (; i < length; i++)
+    {
+      sum += a[i] * b[i];
+    }
+    return sum;
+  }
+
+  /**
+   * Scale a feature vector to unit length in place.
+   */
+  inline void l2Normalize(float *data, size_t length)
+  {
+    const float norm = std::sqrt(dotProduct(data, data, length));
+    if (norm <= 0.0f)
+    {
+      return;
+    }
+    const float scale = 1.0f / norm;
+    for (size_t i = 0; i < length; i++)
+    {
+      data[i] *= scale;
+    }
+  }
+
+} // namespace margelo::nitro::nitroinspireface
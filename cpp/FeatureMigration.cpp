@@ -0,0 +1,379 @@
+#include "FeatureMigration.hpp"
+#include "FeatureGallery.hpp"
+#include "inspireface.h"
+#include <NitroModules/NitroLogger.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace margelo::nitro::nitroinspireface
+{
+  namespace
+  {
+    constexpr const char *TAG = "FeatureMigration";
+    constexpr uint32_t kCheckpointMagic = 0x474D4649; // "IFMG"
+    constexpr uint32_t kCheckpointVersion = 1;
+
+    using FeatureMap = std::unordered_map<int64_t, std::vector<float>>;
+
+    bool updateFeature(int64_t id, std::vector<float> &feature)
+    {
+      HFFaceFeature hfFeature;
+      hfFeature.size = static_cast<HInt32>(feature.size());
+      hfFeature.data = feature.data();
+
+      HFFaceFeatureIdentity identity;
+      identity.id = static_cast<HFaceId>(id);
+      identity.feature = &hfFeature;
+      return HFFeatureHubFaceUpdate(identity) == HSUCCEED;
+    }
+
+    // Load the features finished by a previous run for the same model pack
+    FeatureMap loadCheckpoint(const std::string &path, const std::string &modelTag, int32_t featureLength)
+    {
+      FeatureMap features;
+      std::ifstream file(path, std::ios::binary);
+      if (!file)
+      {
+        return features;
+      }
+
+      uint32_t magic = 0, version = 0, tagLength = 0;
+      int32_t length = 0;
+      file.read(reinterpret_cast<char *>(&magic), sizeof(magic));
+      file.read(reinterpret_cast<char *>(&version), sizeof(version));
+      file.read(reinterpret_cast<char *>(&tagLength), sizeof(tagLength));
+      if (!file || magic != kCheckpointMagic || version != kCheckpointVersion || tagLength > 4096)
+      {
+        return features;
+      }
+
+      std::string tag(tagLength, '\0');
+      file.read(tag.data(), tagLength);
+      file.read(reinterpret_cast<char *>(&length), sizeof(length));
+      if (!file || tag != modelTag || length != featureLength)
+      {
+        // Checkpoint belongs to another model pack, start over
+        return features;
+      }
+
+      // Records are appended one at a time, a trailing partial record is ignored
+      while (true)
+      {
+        int64_t id = 0;
+        std::vector<float> feature(featureLength);
+        file.read(reinterpret_cast<char *>(&id), sizeof(id));
+        file.read(reinterpret_cast<char *>(feature.data()), featureLength * sizeof(float));
+        if (!file)
+        {
+          break;
+        }
+        features[id] = std::move(feature);
+      }
+      return features;
+    }
+
+    void writeCheckpointHeader(std::ofstream &file, const std::string &modelTag, int32_t featureLength)
+    {
+      const uint32_t tagLength = static_cast<uint32_t>(modelTag.size());
+      file.write(reinterpret_cast<const char *>(&kCheckpointMagic), sizeof(kCheckpointMagic));
+      file.write(reinterpret_cast<const char *>(&kCheckpointVersion), sizeof(kCheckpointVersion));
+      file.write(reinterpret_cast<const char *>(&tagLength), sizeof(tagLength));
+      file.write(modelTag.data(), tagLength);
+      file.write(reinterpret_cast<const char *>(&featureLength), sizeof(featureLength));
+    }
+
+    // Aligned crops are tight around the face, pad them so the detector sees some context
+    bool extractFromCrop(HFSession session, const std::vector<uint8_t> &crop, int32_t width, int32_t height, int32_t channels,
+                         int32_t featureLength, std::vector<float> &feature)
+    {
+      if (channels != 1 && channels != 3)
+      {
+        return false;
+      }
+
+      const int32_t canvasWidth = width * 2;
+      const int32_t canvasHeight = height * 2;
+      const int32_t offsetX = width / 2;
+      const int32_t offsetY = height / 2;
+      std::vector<uint8_t> canvas(static_cast<size_t>(canvasWidth) * canvasHeight * 3, 0);
+      for (int32_t y = 0; y < height; y++)
+      {
+        uint8_t *dst = canvas.data() + (static_cast<size_t>(y + offsetY) * canvasWidth + offsetX) * 3;
+        const uint8_t *src = crop.data() + static_cast<size_t>(y) * width * channels;
+        if (channels == 3)
+        {
+          std::memcpy(dst, src, static_cast<size_t>(width) * 3);
+        }
+        else
+        {
+          for (int32_t x = 0; x < width; x++)
+          {
+            dst[x * 3] = dst[x * 3 + 1] = dst[x * 3 + 2] = src[x];
+          }
+        }
+      }
+
+      HFImageData imageData{};
+      imageData.data = canvas.data();
+      imageData.width = canvasWidth;
+      imageData.height = canvasHeight;
+      imageData.format = HF_STREAM_BGR;
+      imageData.rotation = HF_CAMERA_ROTATION_0;
+
+      HFImageStream stream = nullptr;
+      if (HFCreateImageStream(&imageData, &stream) != HSUCCEED || stream == nullptr)
+      {
+        return false;
+      }
+
+      bool extracted = false;
+      HFMultipleFaceData faces{};
+      if (HFExecuteFaceTrack(session, stream, &faces) == HSUCCEED && faces.detectedNum > 0)
+      {
+        // Use the largest face, the crop only ever contains one person
+        int32_t best = 0;
+        for (int32_t i = 1; i < faces.detectedNum; i++)
+        {
+          if (faces.rects[i].width * faces.rects[i].height > faces.rects[best].width * faces.rects[best].height)
+          {
+            best = i;
+          }
+        }
+
+        HFFaceFeature result{};
+        if (HFFaceFeatureExtract(session, stream, faces.tokens[best], &result) == HSUCCEED &&
+            result.data != nullptr && result.size == featureLength)
+        {
+          feature.assign(result.data, result.data + result.size);
+          extracted = true;
+        }
+      }
+
+      HFReleaseImageStream(stream);
+      return extracted;
+    }
+  } // namespace
+
+  FeatureMigration &FeatureMigration::shared()
+  {
+    static FeatureMigration instance;
+    return instance;
+  }
+
+  void FeatureMigration::cancel()
+  {
+    _cancelled = true;
+  }
+
+  FeatureMigrationStats FeatureMigration::run(int32_t workerCount, const std::function<void(size_t, size_t)> &onProgress)
+  {
+    if (_running.exchange(true))
+    {
+      throw std::runtime_error("A feature migration is already running");
+    }
+    _cancelled = false;
+
+    struct RunningGuard
+    {
+      std::atomic<bool> &running;
+      ~RunningGuard() { running = false; }
+    } guard{_running};
+
+    FeatureGallery &gallery = FeatureGallery::shared();
+    FeatureMigrationStats stats;
+    stats.modelTag = gallery.getModelTag();
+
+    HInt32 featureLength = 0;
+    if (HFGetFeatureLength(&featureLength) != HSUCCEED || featureLength <= 0)
+    {
+      throw std::runtime_error("Failed to get feature length");
+    }
+
+    // Only ids with a stored crop can be re-extracted
+    std::vector<int64_t> staleIds;
+    for (int64_t id : gallery.getStaleIds())
+    {
+      if (gallery.hasCrop(id))
+      {
+        staleIds.push_back(id);
+      }
+      else
+      {
+        stats.skipped++;
+      }
+    }
+
+    const std::string checkpointPath = gallery.getCheckpointPath();
+    FeatureMap features;
+    if (!checkpointPath.empty())
+    {
+      features = loadCheckpoint(checkpointPath, stats.modelTag, featureLength);
+    }
+
+    std::vector<int64_t> pending;
+    for (int64_t id : staleIds)
+    {
+      if (features.find(id) == features.end())
+      {
+        pending.push_back(id);
+      }
+    }
+
+    Logger::log(LogLevel::Info, TAG, "Migrating %zu features to '%s' (%zu restored from checkpoint)",
+                staleIds.size(), stats.modelTag.c_str(), staleIds.size() - pending.size());
+
+    std::ofstream checkpoint;
+    if (!checkpointPath.empty())
+    {
+      if (features.empty())
+      {
+        checkpoint.open(checkpointPath, std::ios::binary | std::ios::trunc);
+        writeCheckpointHeader(checkpoint, stats.modelTag, featureLength);
+      }
+      else
+      {
+        checkpoint.open(checkpointPath, std::ios::binary | std::ios::app);
+      }
+    }
+
+    const size_t total = staleIds.size();
+    size_t completed = total - pending.size();
+    std::atomic<size_t> next{0};
+    std::atomic<int64_t> failed{0};
+    std::mutex resultMutex;
+
+    auto worker = [&]()
+    {
+      HFSessionCustomParameter parameter{};
+      parameter.enable_recognition = 1;
+      HFSession session = nullptr;
+      HResult result = HFCreateInspireFaceSession(parameter, HF_DETECT_MODE_ALWAYS_DETECT, 1, 160, -1, &session);
+      if (result != HSUCCEED || session == nullptr)
+      {
+        Logger::log(LogLevel::Error, TAG, "Failed to create migration session with error code: %ld", result);
+        return;
+      }
+
+      std::vector<uint8_t> crop;
+      std::vector<float> feature;
+      for (size_t index = next++; index < pending.size() && !_cancelled; index = next++)
+      {
+        const int64_t id = pending[index];
+        int32_t width = 0, height = 0, channels = 0;
+        const bool ok = gallery.loadCrop(id, crop, width, height, channels) &&
+                        extractFromCrop(session, crop, width, height, channels, featureLength, feature);
+
+        std::lock_guard<std::mutex> lock(resultMutex);
+        if (ok)
+        {
+          if (checkpoint.is_open())
+          {
+            checkpoint.write(reinterpret_cast<const char *>(&id), sizeof(id));
+            checkpoint.write(reinterpret_cast<const char *>(feature.data()), featureLength * sizeof(float));
+            checkpoint.flush();
+          }
+          features[id] = feature;
+        }
+        else
+        {
+          failed++;
+        }
+        completed++;
+        if (onProgress)
+        {
+          onProgress(completed, total);
+        }
+      }
+
+      HFReleaseInspireFaceSession(session);
+    };
+
+    const int32_t threadCount = std::max<int32_t>(1, std::min<int32_t>(workerCount, static_cast<int32_t>(pending.size())));
+    std::vector<std::thread> threads;
+    threads.reserve(threadCount);
+    for (int32_t i = 0; i < threadCount; i++)
+    {
+      threads.emplace_back(worker);
+    }
+    for (auto &thread : threads)
+    {
+      thread.join();
+    }
+    checkpoint.close();
+
+    stats.failed = failed;
+    if (_cancelled)
+    {
+      // Keep the checkpoint so the next run resumes from here
+      stats.cancelled = true;
+      stats.migrated = 0;
+      return stats;
+    }
+
+    // Swap all features in one go so searches never mix model generations. Every search holds
+    // hubMutex, and a failed update rolls back the ones already written, so the swap is all or nothing
+    std::vector<int64_t> migratedIds;
+    {
+      std::lock_guard<std::mutex> hubLock(gallery.hubMutex());
+      FeatureMap previous;
+      bool swapped = true;
+      for (auto &[id, feature] : features)
+      {
+        // Skip ids that were removed or re-enrolled with the new model meanwhile
+        HFFaceFeatureIdentity current = {};
+        if (HFFeatureHubGetFaceIdentity(static_cast<HFaceId>(id), &current) != HSUCCEED || !current.feature ||
+            gallery.getTag(id) == stats.modelTag)
+        {
+          continue;
+        }
+        std::vector<float> &saved = previous[id];
+        saved.assign(current.feature->data, current.feature->data + current.feature->size);
+
+        if (!updateFeature(id, feature))
+        {
+          Logger::log(LogLevel::Error, TAG, "Failed to update feature %lld, rolling back the migration", static_cast<long long>(id));
+          swapped = false;
+          break;
+        }
+        migratedIds.push_back(id);
+      }
+
+      if (!swapped)
+      {
+        for (int64_t id : migratedIds)
+        {
+          if (!updateFeature(id, previous[id]))
+          {
+            Logger::log(LogLevel::Error, TAG, "Failed to restore feature %lld", static_cast<long long>(id));
+          }
+        }
+        // Keep the checkpoint so the next run retries without extracting again
+        stats.failed += static_cast<int64_t>(previous.size());
+        stats.migrated = 0;
+        return stats;
+      }
+
+      for (int64_t id : migratedIds)
+      {
+        gallery.putFeature(id, features[id].data(), featureLength);
+      }
+      gallery.tag(migratedIds, stats.modelTag);
+    }
+
+    if (!checkpointPath.empty())
+    {
+      std::remove(checkpointPath.c_str());
+    }
+
+    stats.migrated = static_cast<int64_t>(migratedIds.size());
+    return stats;
+  }
+
+} // namespace margelo::nitro::nitroinspireface
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+namespace margelo::nitro::nitroinspireface
+{
+  /**
+   * Outcome of a FeatureHub re-embedding run.
+   */
+  struct FeatureMigrationStats
+  {
+    int64_t migrated = 0;
+    int64_t failed = 0;
+    int64_t skipped = 0;
+    bool cancelled = false;
+    std::string modelTag;
+  };
+
+  /**
+   * Re-extracts stale FeatureHub features from their stored aligned face crops
+   * after a model pack change.
+   *
+   * Extraction runs on a pool of worker sessions and every finished feature is
+   * appended to a checkpoint file, so an interrupted run picks up where it left
+   * off. The FeatureHub is only touched once all features are ready, inside a
+   * single critical section, so searches never see a half-migrated gallery.
+   */
+  class FeatureMigration
+  {
+  public:
+    static FeatureMigration &shared();
+
+    FeatureMigrationStats run(int32_t workerCount, const std::function<void(size_t, size_t)> &onProgress);
+    void cancel();
+
+  private:
+    FeatureMigration() = default;
+
+  private:
+    std::atomic<bool> _running{false};
+    std::atomic<bool> _cancelled{false};
+  };
+
+} // namespace margelo::nitro::nitroinspireface
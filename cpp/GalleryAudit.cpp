@@ -0,0 +1,174 @@
+#include "GalleryAudit.hpp"
+#include "FeatureGallery.hpp"
+#include "FeatureMath.hpp"
+#include <NitroModules/NitroLogger.hpp>
+#include <algorithm>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+namespace margelo::nitro::nitroinspireface
+{
+  namespace
+  {
+    constexpr const char *TAG = "GalleryAudit";
+    // 64 rows of 512 floats keep two blocks inside a typical L2 cache
+    constexpr size_t kBlockRows = 64;
+
+    struct NearestImpostor
+    {
+      int64_t id = -1;
+      float similarity = -std::numeric_limits<float>::infinity();
+    };
+  } // namespace
+
+  GalleryAudit &GalleryAudit::shared()
+  {
+    static GalleryAudit instance;
+    return instance;
+  }
+
+  void GalleryAudit::cancel()
+  {
+    _cancelled = true;
+  }
+
+  AuditStats GalleryAudit::run(float threshold, int32_t workerCount, const std::function<void(size_t, size_t)> &onProgress)
+  {
+    if (_running.exchange(true))
+    {
+      throw std::runtime_error("A gallery audit is already running");
+    }
+    _cancelled = false;
+
+    struct RunningGuard
+    {
+      std::atomic<bool> &running;
+      ~RunningGuard() { running = false; }
+    } guard{_running};
+
+    // Work on a snapshot so searches and enrollments are not blocked by the scan
+    std::vector<int64_t> ids;
+    std::vector<float> matrix;
+    int32_t featureLength = 0;
+    {
+      FeatureGallery &gallery = FeatureGallery::shared();
+      std::lock_guard<std::mutex> hubLock(gallery.hubMutex());
+      if (!gallery.snapshotFeatures(ids, matrix, featureLength))
+      {
+        throw std::runtime_error("Failed to read the FeatureHub features");
+      }
+    }
+
+    AuditStats stats;
+    const size_t rows = ids.size();
+    if (rows < 2)
+    {
+      return stats;
+    }
+
+    // Upper triangle of block pairs, including each block against itself
+    const size_t blocks = (rows + kBlockRows - 1) / kBlockRows;
+    std::vector<std::pair<size_t, size_t>> tiles;
+    tiles.reserve(blocks * (blocks + 1) / 2);
+    for (size_t a = 0; a < blocks; a++)
+    {
+      for (size_t b = a; b < blocks; b++)
+      {
+        tiles.emplace_back(a, b);
+      }
+    }
+
+    Logger::log(LogLevel::Info, TAG, "Auditing %zu features in %zu tiles", rows, tiles.size());
+
+    const size_t total = tiles.size();
+    std::atomic<size_t> next{0};
+    std::atomic<size_t> completed{0};
+    std::mutex resultMutex;
+    std::mutex progressMutex;
+    std::vector<NearestImpostor> nearest(rows);
+
+    auto worker = [&]()
+    {
+      // Results stay thread local until the end, tiles never wait on each other
+      std::vector<AuditPair> pairs;
+      std::vector<NearestImpostor> localNearest(rows);
+      for (size_t index = next++; index < total && !_cancelled; index = next++)
+      {
+        const auto [blockA, blockB] = tiles[index];
+        const size_t endA = std::min(rows, (blockA + 1) * kBlockRows);
+        const size_t endB = std::min(rows, (blockB + 1) * kBlockRows);
+        for (size_t i = blockA * kBlockRows; i < endA; i++)
+        {
+          const float *rowI = matrix.data() + i * featureLength;
+          const size_t startJ = blockA == blockB ? i + 1 : blockB * kBlockRows;
+          for (size_t j = startJ; j < endB; j++)
+          {
+            const float similarity = dotProduct(rowI, matrix.data() + j * featureLength, featureLength);
+            if (similarity > localNearest[i].similarity)
+            {
+              localNearest[i] = {ids[j], similarity};
+            }
+            if (similarity > localNearest[j].similarity)
+            {
+              localNearest[j] = {ids[i], similarity};
+            }
+            if (similarity >= threshold)
+            {
+              pairs.push_back({ids[i], ids[j], similarity});
+            }
+          }
+        }
+
+        const size_t done = ++completed;
+        if (onProgress)
+        {
+          std::lock_guard<std::mutex> lock(progressMutex);
+          onProgress(done, total);
+        }
+      }
+
+      std::lock_guard<std::mutex> lock(resultMutex);
+      stats.pairs.insert(stats.pairs.end(), pairs.begin(), pairs.end());
+      for (size_t row = 0; row < rows; row++)
+      {
+        if (localNearest[row].similarity > nearest[row].similarity)
+        {
+          nearest[row] = localNearest[row];
+        }
+      }
+    };
+
+    const int32_t threadCount = std::max<int32_t>(1, std::min<int32_t>(workerCount, static_cast<int32_t>(total)));
+    std::vector<std::thread> threads;
+    threads.reserve(threadCount);
+    for (int32_t i = 0; i < threadCount; i++)
+    {
+      threads.emplace_back(worker);
+    }
+    for (auto &thread : threads)
+    {
+      thread.join();
+    }
+
+    if (_cancelled)
+    {
+      stats.cancelled = true;
+      stats.pairs.clear();
+      return stats;
+    }
+
+    // Most similar pairs first, the order workers finished in is meaningless
+    std::sort(stats.pairs.begin(), stats.pairs.end(), [](const AuditPair &a, const AuditPair &b)
+              { return a.similarity > b.similarity; });
+
+    stats.neighbors.reserve(rows);
+    for (size_t row = 0; row < rows; row++)
+    {
+      stats.neighbors.push_back({ids[row], nearest[row].id, nearest[row].similarity});
+    }
+    return stats;
+  }
+
+} // namespace margelo::nitro::nitroinspireface
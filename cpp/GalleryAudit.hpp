@@ -0,0 +1,60 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace margelo::nitro::nitroinspireface
+{
+  /**
+   * Two stored ids whose features are more similar than the audit threshold.
+   */
+  struct AuditPair
+  {
+    int64_t first;
+    int64_t second;
+    float similarity;
+  };
+
+  /**
+   * Closest other id (the nearest impostor) of a stored id.
+   */
+  struct AuditNeighbor
+  {
+    int64_t id;
+    int64_t nearestId;
+    float similarity;
+  };
+
+  struct AuditStats
+  {
+    std::vector<AuditPair> pairs;
+    std::vector<AuditNeighbor> neighbors;
+    bool cancelled = false;
+  };
+
+  /**
+   * All-pairs similarity scan over the FeatureHub.
+   *
+   * The gallery is split into blocks of rows and every pair of blocks is one
+   * work item, so workers stay inside a cache-sized tile of the feature matrix.
+   * Similarities are cosine scores, the same as HFFaceComparison.
+   */
+  class GalleryAudit
+  {
+  public:
+    static GalleryAudit &shared();
+
+    AuditStats run(float threshold, int32_t workerCount, const std::function<void(size_t, size_t)> &onProgress);
+    void cancel();
+
+  private:
+    GalleryAudit() = default;
+
+  private:
+    std::atomic<bool> _running{false};
+    std::atomic<bool> _cancelled{false};
+  };
+
+} // namespace margelo::nitro::nitroinspireface
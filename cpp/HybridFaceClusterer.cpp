@@ -0,0 +1,404 @@
+#include "HybridFaceClusterer.hpp"
+#include "FeatureMath.hpp"
+#include <NitroModules/NitroLogger.hpp>
+#include <algorithm>
+#include <atomic>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+namespace margelo::nitro::nitroinspireface
+{
+  namespace
+  {
+    // Query rows handled per work item, small enough to balance threads
+    constexpr size_t kBlockRows = 64;
+
+    struct Neighbor
+    {
+      uint32_t row;
+      float similarity;
+    };
+
+    // Keep the k most similar neighbors, sorted from most to least similar
+    void insertNeighbor(std::vector<Neighbor> &neighbors, size_t k, uint32_t row, float similarity)
+    {
+      if (neighbors.size() == k && similarity <= neighbors.back().similarity)
+      {
+        return;
+      }
+      auto position = std::upper_bound(neighbors.begin(), neighbors.end(), similarity,
+                                       [](float value, const Neighbor &neighbor)
+                                       { return value > neighbor.similarity; });
+      neighbors.insert(position, {row, similarity});
+      if (neighbors.size() > k)
+      {
+        neighbors.pop_back();
+      }
+    }
+  } // namespace
+
+  HybridFaceClusterer::HybridFaceClusterer() : HybridObject(TAG) {}
+
+  HybridFaceClusterer::HybridFaceClusterer(float threshold, int32_t neighborCount, int32_t iterations)
+      : HybridObject(TAG), _threshold(threshold), _neighborCount(std::max<int32_t>(1, neighborCount)),
+        _iterations(std::max<int32_t>(1, iterations)) {}
+
+  void HybridFaceClusterer::dispose()
+  {
+    clear();
+  }
+
+  double HybridFaceClusterer::getFaceCount()
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return static_cast<double>(_labels.size());
+  }
+
+  double HybridFaceClusterer::getClusterCount()
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return static_cast<double>(_labelCount);
+  }
+
+  size_t HybridFaceClusterer::appendFeature(const std::shared_ptr<ArrayBuffer> &feature)
+  {
+    if (!feature || feature->size() == 0 || feature->size() % sizeof(float) != 0)
+    {
+      throw std::runtime_error("Invalid feature data");
+    }
+
+    const int32_t length = static_cast<int32_t>(feature->size() / sizeof(float));
+    if (_featureLength == 0)
+    {
+      _featureLength = length;
+    }
+    else if (length != _featureLength)
+    {
+      throw std::runtime_error("Invalid feature size. Expected " + std::to_string(_featureLength * sizeof(float)) +
+                               " bytes but got " + std::to_string(feature->size()));
+    }
+
+    const float *data = reinterpret_cast<const float *>(feature->data());
+    _matrix.insert(_matrix.end(), data, data + length);
+    l2Normalize(_matrix.data() + _labels.size() * length, length);
+    _edges.emplace_back();
+    _labels.push_back(-1);
+    return _labels.size() - 1;
+  }
+
+  double HybridFaceClusterer::addFace(const std::shared_ptr<ArrayBuffer> &feature)
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    const size_t row = appendFeature(feature);
+    if (_clustered)
+    {
+      absorb(row);
+    }
+    return static_cast<double>(row);
+  }
+
+  std::vector<double> HybridFaceClusterer::addFaces(const std::vector<std::shared_ptr<ArrayBuffer>> &features)
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::vector<double> faceIds;
+    faceIds.reserve(features.size());
+    for (const auto &feature : features)
+    {
+      const size_t row = appendFeature(feature);
+      if (_clustered)
+      {
+        absorb(row);
+      }
+      faceIds.push_back(static_cast<double>(row));
+    }
+    return faceIds;
+  }
+
+  std::shared_ptr<Promise<std::vector<FaceCluster>>> HybridFaceClusterer::cluster(double workerCount)
+  {
+    auto self = shared_cast<HybridFaceClusterer>();
+    return Promise<std::vector<FaceCluster>>::async([self, workerCount]() -> std::vector<FaceCluster>
+    {
+      // Copy the features out, so adding faces and reading clusters stay responsive during the long run
+      std::vector<float> matrix;
+      size_t rows = 0;
+      size_t length = 0;
+      uint64_t generation = 0;
+      {
+        std::lock_guard<std::mutex> lock(self->_mutex);
+        matrix = self->_matrix;
+        rows = self->_labels.size();
+        length = static_cast<size_t>(self->_featureLength);
+        generation = self->_generation;
+      }
+
+      std::vector<std::vector<Edge>> edges;
+      buildGraph(matrix, rows, length, self->_threshold, static_cast<size_t>(self->_neighborCount), static_cast<int32_t>(workerCount), edges);
+      std::vector<int32_t> labels(rows);
+      const int32_t labelCount = runChineseWhispers(edges, labels, self->_iterations);
+
+      std::lock_guard<std::mutex> lock(self->_mutex);
+      if (self->_generation != generation)
+      {
+        Logger::log(LogLevel::Warning, TAG, "Faces were cleared while clustering, the result is dropped");
+        return self->collectClusters();
+      }
+
+      // Faces added while clustering are absorbed into the new clusters, as if added afterwards
+      const size_t total = self->_labels.size();
+      edges.resize(total);
+      labels.resize(total, -1);
+      self->_edges = std::move(edges);
+      self->_labels = std::move(labels);
+      self->_labelCount = labelCount;
+      self->_clustered = true;
+      for (size_t row = rows; row < total; row++)
+      {
+        self->absorb(row);
+      }
+      Logger::log(LogLevel::Info, TAG, "Clustered %zu faces into %d clusters", total, self->_labelCount);
+      return self->collectClusters();
+    });
+  }
+
+  std::vector<FaceCluster> HybridFaceClusterer::getClusters()
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return collectClusters();
+  }
+
+  double HybridFaceClusterer::getClusterId(double faceId)
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (faceId < 0 || faceId >= static_cast<double>(_labels.size()))
+    {
+      throw std::runtime_error("Invalid face id: " + std::to_string(static_cast<int64_t>(faceId)));
+    }
+    return static_cast<double>(_labels[static_cast<size_t>(faceId)]);
+  }
+
+  void HybridFaceClusterer::clear()
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _featureLength = 0;
+    _matrix.clear();
+    _edges.clear();
+    _labels.clear();
+    _labelCount = 0;
+    _clustered = false;
+    _generation++;
+  }
+
+  void HybridFaceClusterer::buildGraph(const std::vector<float> &matrix, size_t rows, size_t length, float threshold, size_t k, int32_t workerCount,
+                                       std::vector<std::vector<Edge>> &edges)
+  {
+    std::vector<std::vector<Neighbor>> nearest(rows);
+
+    // Every query row is owned by exactly one work item, so workers never share a row
+    const size_t blocks = (rows + kBlockRows - 1) / kBlockRows;
+    std::atomic<size_t> next{0};
+    auto worker = [&]()
+    {
+      for (size_t block = next++; block < blocks; block = next++)
+      {
+        const size_t end = std::min(rows, (block + 1) * kBlockRows);
+        // Walk the targets tile by tile so one tile serves all queries of the block
+        for (size_t tile = 0; tile < rows; tile += kBlockRows)
+        {
+          const size_t tileEnd = std::min(rows, tile + kBlockRows);
+          for (size_t i = block * kBlockRows; i < end; i++)
+          {
+            const float *query = matrix.data() + i * length;
+            for (size_t j = tile; j < tileEnd; j++)
+            {
+              if (j == i)
+              {
+                continue;
+              }
+              const float similarity = dotProduct(query, matrix.data() + j * length, length);
+              if (similarity >= threshold)
+              {
+                insertNeighbor(nearest[i], k, static_cast<uint32_t>(j), similarity);
+              }
+            }
+          }
+        }
+      }
+    };
+
+    const int32_t threadCount = std::max<int32_t>(1, std::min<int32_t>(workerCount, static_cast<int32_t>(blocks)));
+    std::vector<std::thread> threads;
+    threads.reserve(threadCount);
+    for (int32_t i = 0; i < threadCount; i++)
+    {
+      threads.emplace_back(worker);
+    }
+    for (auto &thread : threads)
+    {
+      thread.join();
+    }
+
+    // Make the kNN graph undirected, a link found from either side counts
+    edges.assign(rows, {});
+    for (size_t i = 0; i < rows; i++)
+    {
+      for (const auto &neighbor : nearest[i])
+      {
+        edges[i].push_back({neighbor.row, neighbor.similarity});
+        edges[neighbor.row].push_back({static_cast<uint32_t>(i), neighbor.similarity});
+      }
+    }
+    for (auto &links : edges)
+    {
+      std::sort(links.begin(), links.end(), [](const Edge &a, const Edge &b)
+                { return a.to < b.to; });
+      links.erase(std::unique(links.begin(), links.end(), [](const Edge &a, const Edge &b)
+                              { return a.to == b.to; }),
+                  links.end());
+    }
+  }
+
+  int32_t HybridFaceClusterer::runChineseWhispers(const std::vector<std::vector<Edge>> &edges, std::vector<int32_t> &labels, int32_t iterations)
+  {
+    const size_t rows = labels.size();
+    std::iota(labels.begin(), labels.end(), 0);
+
+    // Fixed seed, the same faces always give the same clusters
+    std::mt19937 random(0);
+    std::vector<uint32_t> order(rows);
+    std::iota(order.begin(), order.end(), 0);
+    std::unordered_map<int32_t, float> votes;
+    for (int32_t iteration = 0; iteration < iterations; iteration++)
+    {
+      std::shuffle(order.begin(), order.end(), random);
+      size_t changed = 0;
+      for (uint32_t row : order)
+      {
+        if (edges[row].empty())
+        {
+          continue;
+        }
+        votes.clear();
+        for (const auto &edge : edges[row])
+        {
+          votes[labels[edge.to]] += edge.weight;
+        }
+        int32_t best = labels[row];
+        float bestWeight = 0.0f;
+        for (const auto &[label, weight] : votes)
+        {
+          if (weight > bestWeight || (weight == bestWeight && label < best))
+          {
+            best = label;
+            bestWeight = weight;
+          }
+        }
+        if (best != labels[row])
+        {
+          labels[row] = best;
+          changed++;
+        }
+      }
+      if (changed == 0)
+      {
+        break;
+      }
+    }
+
+    // Renumber the surviving labels from 0
+    std::unordered_map<int32_t, int32_t> compact;
+    for (auto &label : labels)
+    {
+      auto found = compact.find(label);
+      if (found == compact.end())
+      {
+        found = compact.emplace(label, static_cast<int32_t>(compact.size())).first;
+      }
+      label = found->second;
+    }
+    return static_cast<int32_t>(compact.size());
+  }
+
+  void HybridFaceClusterer::absorb(size_t row)
+  {
+    const size_t length = static_cast<size_t>(_featureLength);
+    const float *query = _matrix.data() + row * length;
+    std::vector<Neighbor> nearest;
+    for (size_t j = 0; j < row; j++)
+    {
+      const float similarity = dotProduct(query, _matrix.data() + j * length, length);
+      if (similarity >= _threshold)
+      {
+        insertNeighbor(nearest, static_cast<size_t>(_neighborCount), static_cast<uint32_t>(j), similarity);
+      }
+    }
+
+    // Join the cluster with the strongest links, existing assignments are left alone
+    std::unordered_map<int32_t, float> votes;
+    for (const auto &neighbor : nearest)
+    {
+      _edges[row].push_back({neighbor.row, neighbor.similarity});
+      _edges[neighbor.row].push_back({static_cast<uint32_t>(row), neighbor.similarity});
+      votes[_labels[neighbor.row]] += neighbor.similarity;
+    }
+
+    int32_t best = -1;
+    float bestWeight = 0.0f;
+    for (const auto &[label, weight] : votes)
+    {
+      if (weight > bestWeight || (weight == bestWeight && label < best))
+      {
+        best = label;
+        bestWeight = weight;
+      }
+    }
+    _labels[row] = best >= 0 ? best : _labelCount++;
+  }
+
+  std::vector<FaceCluster> HybridFaceClusterer::collectClusters()
+  {
+    if (!_clustered)
+    {
+      return {};
+    }
+
+    const size_t length = static_cast<size_t>(_featureLength);
+    std::vector<std::vector<double>> members(_labelCount);
+    std::vector<std::vector<float>> centroids(_labelCount, std::vector<float>(length, 0.0f));
+    for (size_t row = 0; row < _labels.size(); row++)
+    {
+      const int32_t label = _labels[row];
+      members[label].push_back(static_cast<double>(row));
+      const float *feature = _matrix.data() + row * length;
+      for (size_t i = 0; i < length; i++)
+      {
+        centroids[label][i] += feature[i];
+      }
+    }
+
+    std::vector<FaceCluster> clusters;
+    clusters.reserve(_labelCount);
+    for (int32_t label = 0; label < _labelCount; label++)
+    {
+      // The representative is the member closest to the mean feature
+      double representative = -1;
+      float bestSimilarity = -2.0f;
+      for (double faceId : members[label])
+      {
+        const float similarity = dotProduct(centroids[label].data(), _matrix.data() + static_cast<size_t>(faceId) * length, length);
+        if (similarity > bestSimilarity)
+        {
+          bestSimilarity = similarity;
+          representative = faceId;
+        }
+      }
+      clusters.emplace_back(static_cast<double>(label), std::move(members[label]), representative);
+    }
+    return clusters;
+  }
+
+} // namespace margelo::nitro::nitroinspireface
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "HybridFaceClustererSpec.hpp"
+#include "FaceCluster.hpp"
+#include <NitroModules/ArrayBuffer.hpp>
+#include <NitroModules/Promise.hpp>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace margelo::nitro::nitroinspireface
+{
+  /**
+   * Implementation of the HybridFaceClusterer module
+   */
+  class HybridFaceClusterer : public virtual HybridFaceClustererSpec
+  {
+  public:
+    // Default constructor required for autolink
+    HybridFaceClusterer();
+
+    // Constructor with clustering settings
+    HybridFaceClusterer(float threshold, int32_t neighborCount, int32_t iterations);
+
+    // Destructor
+    ~HybridFaceClusterer() override = default;
+
+    // Override dispose to clean up resources
+    void dispose() override;
+
+  public:
+    // Properties
+    double getFaceCount() override;
+    double getClusterCount() override;
+
+    // Methods
+    double addFace(const std::shared_ptr<ArrayBuffer> &feature) override;
+    std::vector<double> addFaces(const std::vector<std::shared_ptr<ArrayBuffer>> &features) override;
+    std::shared_ptr<Promise<std::vector<FaceCluster>>> cluster(double workerCount) override;
+    std::vector<FaceCluster> getClusters() override;
+    double getClusterId(double faceId) override;
+    void clear() override;
+
+  private:
+    struct Edge
+    {
+      uint32_t to;
+      float weight;
+    };
+
+    // Clustering runs on a snapshot of the features, without holding _mutex
+    static void buildGraph(const std::vector<float> &matrix, size_t rows, size_t length, float threshold, size_t k, int32_t workerCount,
+                           std::vector<std::vector<Edge>> &edges);
+    static int32_t runChineseWhispers(const std::vector<std::vector<Edge>> &edges, std::vector<int32_t> &labels, int32_t iterations);
+
+    // All other private helpers expect _mutex to be held
+    size_t appendFeature(const std::shared_ptr<ArrayBuffer> &feature);
+    void absorb(size_t row);
+    std::vector<FaceCluster> collectClusters();
+
+  private:
+    std::mutex _mutex;
+    float _threshold = 0.48f;
+    int32_t _neighborCount = 10;
+    int32_t _iterations = 20;
+
+    // Normalized features, one row per face
+    int32_t _featureLength = 0;
+    std::vector<float> _matrix;
+    std::vector<std::vector<Edge>> _edges;
+    std::vector<int32_t> _labels;
+    int32_t _labelCount = 0;
+    bool _clustered = false;
+    // Bumped by clear, a clustering run started before is dropped
+    uint64_t _generation = 0;
+  };
+
+} // namespace margelo::nitro::nitroinspireface
@@ -1,22 +1,131 @@
 #include "HybridImageBitmap.hpp"
+#include "ImageKernels.hpp"
+#include "HybridAssetManagerSpec.hpp"
+#include <NitroModules/HybridObjectRegistry.hpp>
+#include <algorithm>
+#include <cmath>
+#include <mutex>
 #include <stdexcept>
 #include <string>
+#include <vector>
 
 namespace margelo::nitro::nitroinspireface
 {
-  HybridImageBitmap::HybridImageBitmap() : HybridObject(TAG), _bitmap(nullptr) {}
+  namespace
+  {
+    // Output channels and their source channels, 3 channel data is BGR, 4 channel data BGRA
+    int32_t channelMapForFormat(ImageFormat format, int32_t channels, uint8_t *map)
+    {
+      const bool gray = channels == 1;
+      const uint8_t blue = 0;
+      const uint8_t green = gray ? 0 : 1;
+      const uint8_t red = gray ? 0 : 2;
+      const uint8_t alpha = channels == 4 ? 3 : kOpaqueChannel;
+      switch (format)
+      {
+      case ImageFormat::RGB:
+      case ImageFormat::RGBA:
+        map[0] = red;
+        map[1] = green;
+        map[2] = blue;
+        break;
+      case ImageFormat::BGR:
+      case ImageFormat::BGRA:
+        map[0] = blue;
+        map[1] = green;
+        map[2] = red;
+        break;
+      default:
+        throw std::runtime_error("Unsupported bitmap format: " + std::to_string(static_cast<int>(format)));
+      }
+      map[3] = alpha;
+      return format == ImageFormat::RGBA || format == ImageFormat::BGRA ? 4 : 3;
+    }
+
+    // Pixel value of an RGB color, 3 channel data is BGR, 4 channel data BGRA and 1 channel data gray
+    void pixelForColor(const Color &color, int32_t channels, uint8_t *pixel)
+    {
+      const uint8_t r = static_cast<uint8_t>(std::clamp(color.r, 0.0, 255.0));
+      const uint8_t g = static_cast<uint8_t>(std::clamp(color.g, 0.0, 255.0));
+      const uint8_t b = static_cast<uint8_t>(std::clamp(color.b, 0.0, 255.0));
+      if (channels == 1)
+      {
+        pixel[0] = static_cast<uint8_t>((r * 77 + g * 150 + b * 29) >> 8);
+        return;
+      }
+      pixel[0] = b;
+      pixel[1] = g;
+      pixel[2] = r;
+      if (channels == 4)
+      {
+        pixel[3] = 0xFF;
+      }
+    }
+
+    // Rows of the 3x5 digits 0-9 used for track IDs, the high bit is the left column
+    constexpr uint8_t kDigitGlyphs[10][5] = {
+        {7, 5, 5, 5, 7}, {2, 6, 2, 2, 7}, {7, 1, 7, 4, 7}, {7, 1, 7, 1, 7}, {5, 5, 7, 1, 1},
+        {7, 4, 7, 1, 7}, {7, 4, 7, 5, 7}, {7, 1, 1, 1, 1}, {7, 5, 7, 5, 7}, {7, 5, 7, 1, 7}};
+
+    // JPEG quality used when none is given
+    constexpr double kDefaultQuality = 90.0;
+
+    // The platform codecs live in the AssetManager, created once on the JS thread and shared by all bitmaps
+    std::shared_ptr<HybridAssetManagerSpec> platformCodec()
+    {
+      static std::shared_ptr<HybridAssetManagerSpec> codec;
+      static std::mutex mutex;
+      std::lock_guard<std::mutex> lock(mutex);
+      if (!codec)
+      {
+        codec = std::dynamic_pointer_cast<HybridAssetManagerSpec>(HybridObjectRegistry::createHybridObject("AssetManager"));
+        if (!codec)
+        {
+          throw std::runtime_error("Failed to create AssetManager");
+        }
+      }
+      return codec;
+    }
+  } // namespace
 
-  HybridImageBitmap::HybridImageBitmap(HFImageBitmap bitmap) : HybridObject(TAG), _bitmap(bitmap)
+  HybridImageBitmap::HybridImageBitmap() : HybridObject(TAG) {}
+
+  HybridImageBitmap::HybridImageBitmap(HFImageBitmap bitmap) : HybridObject(TAG)
   {
+    if (bitmap != nullptr)
+    {
+      _bitmap = std::shared_ptr<void>(bitmap, [](HFImageBitmap handle)
+                                      { HFReleaseImageBitmap(handle); });
+      loadHeader();
+    }
   }
 
-  void HybridImageBitmap::cleanup()
+  HybridImageBitmap::HybridImageBitmap(std::shared_ptr<ArrayBuffer> buffer, int32_t width, int32_t height, int32_t channels, bool writable)
+      : HybridObject(TAG), _adopted(std::move(buffer)), _writable(writable)
+  {
+    _header.data = _adopted->data();
+    _header.width = width;
+    _header.height = height;
+    _header.channels = channels;
+  }
+
+  void HybridImageBitmap::loadHeader()
   {
-    if (_bitmap != nullptr)
+    HFImageBitmapData bitmapData{};
+    HResult result = HFImageBitmapGetData(getNativeHandle(), &bitmapData);
+    if (result != HSUCCEED || bitmapData.data == nullptr)
     {
-      HFReleaseImageBitmap(_bitmap);
-      _bitmap = nullptr;
+      throw std::runtime_error("Failed to get bitmap data with error code: " + std::to_string(result));
     }
+    _header = bitmapData;
+  }
+
+  void HybridImageBitmap::cleanup()
+  {
+    // Data views still holding the bitmap keep it alive until they are released
+    _bitmap.reset();
+    _adopted.reset();
+    _header = {};
   }
 
   HybridImageBitmap::~HybridImageBitmap()
@@ -31,74 +140,64 @@ namespace margelo::nitro::nitroinspireface
 
   double HybridImageBitmap::getWidth()
   {
-    if (_bitmap == nullptr)
-    {
-      throw std::runtime_error("HybridImageBitmap is not initialized");
-    }
-
-    HFImageBitmapData bitmapData{};
-    HResult result = HFImageBitmapGetData(_bitmap, &bitmapData);
-    if (result != HSUCCEED)
-    {
-      throw std::runtime_error("Failed to get bitmap data with error code: " + std::to_string(result));
-    }
-
-    return static_cast<double>(bitmapData.width);
+    return static_cast<double>(getNativeData().width);
   }
 
   double HybridImageBitmap::getHeight()
   {
-    if (_bitmap == nullptr)
-    {
-      throw std::runtime_error("HybridImageBitmap is not initialized");
-    }
+    return static_cast<double>(getNativeData().height);
+  }
 
-    HFImageBitmapData bitmapData{};
-    HResult result = HFImageBitmapGetData(_bitmap, &bitmapData);
-    if (result != HSUCCEED)
+  double HybridImageBitmap::getChannels()
+  {
+    return static_cast<double>(getNativeData().channels);
+  }
+
+  std::shared_ptr<void> HybridImageBitmap::pin() const
+  {
+    if (_adopted != nullptr)
     {
-      throw std::runtime_error("Failed to get bitmap data with error code: " + std::to_string(result));
+      return std::shared_ptr<void>(_adopted, _adopted->data());
     }
-
-    return static_cast<double>(bitmapData.height);
+    return _bitmap;
   }
 
-  double HybridImageBitmap::getChannels()
+  void HybridImageBitmap::makeWritable()
   {
-    if (_bitmap == nullptr)
+    const HFImageBitmapData &bitmapData = getNativeData();
+    if (_adopted == nullptr)
     {
-      throw std::runtime_error("HybridImageBitmap is not initialized");
+      return;
     }
 
-    HFImageBitmapData bitmapData{};
-    HResult result = HFImageBitmapGetData(_bitmap, &bitmapData);
-    if (result != HSUCCEED)
+    HFImageBitmapData copy = bitmapData;
+    HFImageBitmap bitmap = nullptr;
+    HResult result = HFCreateImageBitmap(&copy, &bitmap);
+    if (result != HSUCCEED || bitmap == nullptr)
     {
-      throw std::runtime_error("Failed to get bitmap data with error code: " + std::to_string(result));
+      throw std::runtime_error("Failed to copy adopted bitmap with error code: " + std::to_string(result));
     }
-
-    return static_cast<double>(bitmapData.channels);
+    Logger::log(LogLevel::Debug, TAG, "Copied adopted %dx%d bitmap before drawing", bitmapData.width, bitmapData.height);
+    _bitmap = std::shared_ptr<void>(bitmap, [](HFImageBitmap handle)
+                                    { HFReleaseImageBitmap(handle); });
+    _adopted.reset();
+    loadHeader();
   }
 
   std::shared_ptr<ArrayBuffer> HybridImageBitmap::getData()
   {
-    if (_bitmap == nullptr)
-    {
-      throw std::runtime_error("HybridImageBitmap is not initialized");
-    }
-
-    HFImageBitmapData bitmapData{};
-    HResult result = HFImageBitmapGetData(_bitmap, &bitmapData);
-    if (result != HSUCCEED)
+    // A caller's adopted buffer is never handed back, writes through it would reach the bitmap
+    const HFImageBitmapData &bitmapData = getNativeData();
+    if (_adopted != nullptr && _writable)
     {
-      throw std::runtime_error("Failed to get bitmap data with error code: " + std::to_string(result));
+      return _adopted;
     }
-
-    // Calculate total size of the image data
+    makeWritable();
     size_t dataSize = static_cast<size_t>(bitmapData.width) * static_cast<size_t>(bitmapData.height) * static_cast<size_t>(bitmapData.channels);
 
-    // Create a copy of the data in an ArrayBuffer
-    return ArrayBuffer::copy(bitmapData.data, dataSize);
+    // Wrap the bitmap memory instead of copying it, the buffer holds the bitmap until it is released
+    std::shared_ptr<void> owner = _bitmap;
+    return ArrayBuffer::wrap(bitmapData.data, dataSize, [owner]() {});
   }
 
   // void HybridImageBitmap::writeToFile(const std::string &filePath)
@@ -117,10 +216,7 @@ namespace margelo::nitro::nitroinspireface
 
   void HybridImageBitmap::drawRect(const FaceRect &rect, const Color &color, double thickness)
   {
-    if (_bitmap == nullptr)
-    {
-      throw std::runtime_error("HybridImageBitmap is not initialized");
-    }
+    makeWritable();
 
     HFaceRect nativeRect = {
         static_cast<HInt32>(rect.x),
@@ -133,7 +229,7 @@ namespace margelo::nitro::nitroinspireface
         static_cast<HFloat>(color.g),
         static_cast<HFloat>(color.b)};
 
-    HResult result = HFImageBitmapDrawRect(_bitmap, nativeRect, nativeColor, static_cast<int>(thickness));
+    HResult result = HFImageBitmapDrawRect(getNativeHandle(), nativeRect, nativeColor, static_cast<int>(thickness));
     if (result != HSUCCEED)
     {
       throw std::runtime_error("Failed to draw rectangle with error code: " + std::to_string(result));
@@ -142,10 +238,7 @@ namespace margelo::nitro::nitroinspireface
 
   void HybridImageBitmap::drawCircleF(const Point2f &point, double radius, const Color &color, double thickness)
   {
-    if (_bitmap == nullptr)
-    {
-      throw std::runtime_error("HybridImageBitmap is not initialized");
-    }
+    makeWritable();
 
     HPoint2f nativePoint = {
         static_cast<HFloat>(point.x),
@@ -156,7 +249,7 @@ namespace margelo::nitro::nitroinspireface
         static_cast<HFloat>(color.g),
         static_cast<HFloat>(color.b)};
 
-    HResult result = HFImageBitmapDrawCircleF(_bitmap, nativePoint, static_cast<int>(radius), nativeColor, static_cast<int>(thickness));
+    HResult result = HFImageBitmapDrawCircleF(getNativeHandle(), nativePoint, static_cast<int>(radius), nativeColor, static_cast<int>(thickness));
     if (result != HSUCCEED)
     {
       throw std::runtime_error("Failed to draw circle with error code: " + std::to_string(result));
@@ -165,10 +258,7 @@ namespace margelo::nitro::nitroinspireface
 
   void HybridImageBitmap::drawCircle(const Point2i &point, double radius, const Color &color, double thickness)
   {
-    if (_bitmap == nullptr)
-    {
-      throw std::runtime_error("HybridImageBitmap is not initialized");
-    }
+    makeWritable();
 
     HPoint2i nativePoint = {
         static_cast<HInt32>(point.x),
@@ -179,10 +269,292 @@ namespace margelo::nitro::nitroinspireface
         static_cast<HFloat>(color.g),
         static_cast<HFloat>(color.b)};
 
-    HResult result = HFImageBitmapDrawCircle(_bitmap, nativePoint, static_cast<int>(radius), nativeColor, static_cast<int>(thickness));
+    HResult result = HFImageBitmapDrawCircle(getNativeHandle(), nativePoint, static_cast<int>(radius), nativeColor, static_cast<int>(thickness));
     if (result != HSUCCEED)
     {
       throw std::runtime_error("Failed to draw circle with error code: " + std::to_string(result));
     }
   }
+
+  void HybridImageBitmap::drawFaces(const std::vector<FaceData> &faces, const OverlayStyle &style, const std::optional<std::shared_ptr<ArrayBuffer>> &landmarks)
+  {
+    uint8_t *data = getWritableData();
+    const HFImageBitmapData &bitmapData = getNativeData();
+    const int32_t width = bitmapData.width;
+    const int32_t height = bitmapData.height;
+    const int32_t channels = bitmapData.channels;
+
+    uint8_t color[4];
+    pixelForColor(style.color, channels, color);
+    const int32_t thickness = std::max(1, static_cast<int32_t>(std::lround(style.thickness.value_or(2.0))));
+    for (const auto &face : faces)
+    {
+      const int32_t x0 = static_cast<int32_t>(std::lround(face.rect.x));
+      const int32_t y0 = static_cast<int32_t>(std::lround(face.rect.y));
+      const int32_t x1 = x0 + static_cast<int32_t>(std::lround(face.rect.width));
+      const int32_t y1 = y0 + static_cast<int32_t>(std::lround(face.rect.height));
+      fillRect(data, width, height, channels, x0, y0, x1, y0 + thickness, color);
+      fillRect(data, width, height, channels, x0, y1 - thickness, x1, y1, color);
+      fillRect(data, width, height, channels, x0, y0 + thickness, x0 + thickness, y1 - thickness, color);
+      fillRect(data, width, height, channels, x1 - thickness, y0 + thickness, x1, y1 - thickness, color);
+    }
+
+    if (style.showTrackId.value_or(true))
+    {
+      // Digits in black or white, whichever stands out on the label background
+      const double luma = 0.299 * style.color.r + 0.587 * style.color.g + 0.114 * style.color.b;
+      uint8_t ink[4];
+      pixelForColor(luma > 128.0 ? Color(0, 0, 0) : Color(255, 255, 255), channels, ink);
+      const int32_t scale = std::max(1, static_cast<int32_t>(std::lround(style.labelSize.value_or(10.0) / 5.0)));
+      for (const auto &face : faces)
+      {
+        if (face.trackId < 0)
+        {
+          continue;
+        }
+        const std::string digits = std::to_string(static_cast<int64_t>(face.trackId));
+        const int32_t labelWidth = static_cast<int32_t>(digits.size()) * 4 * scale + scale;
+        const int32_t labelHeight = 7 * scale;
+        const int32_t x = static_cast<int32_t>(std::lround(face.rect.x));
+        int32_t y = static_cast<int32_t>(std::lround(face.rect.y)) - labelHeight;
+        if (y < 0)
+        {
+          // No room above the face, keep the label inside the rectangle
+          y += labelHeight;
+        }
+        fillRect(data, width, height, channels, x, y, x + labelWidth, y + labelHeight, color);
+        for (size_t i = 0; i < digits.size(); i++)
+        {
+          const uint8_t *glyph = kDigitGlyphs[digits[i] - '0'];
+          const int32_t glyphX = x + scale + static_cast<int32_t>(i) * 4 * scale;
+          for (int32_t row = 0; row < 5; row++)
+          {
+            for (int32_t column = 0; column < 3; column++)
+            {
+              if (glyph[row] & (4 >> column))
+              {
+                const int32_t dotX = glyphX + column * scale;
+                const int32_t dotY = y + scale + row * scale;
+                fillRect(data, width, height, channels, dotX, dotY, dotX + scale, dotY + scale, ink);
+              }
+            }
+          }
+        }
+      }
+    }
+
+    if (landmarks.has_value() && landmarks.value())
+    {
+      drawPoints(landmarks.value(), style.pointColor.value_or(style.color), style.pointSize);
+    }
+  }
+
+  void HybridImageBitmap::drawPoints(const std::shared_ptr<ArrayBuffer> &points, const Color &color, std::optional<double> size)
+  {
+    if (!points || points->size() % (2 * sizeof(float)) != 0)
+    {
+      throw std::runtime_error("Invalid point data, expected float32 x, y pairs");
+    }
+    uint8_t *data = getWritableData();
+    const HFImageBitmapData &bitmapData = getNativeData();
+
+    uint8_t pixel[4];
+    pixelForColor(color, bitmapData.channels, pixel);
+    const int32_t side = std::max(1, static_cast<int32_t>(std::lround(size.value_or(2.0))));
+    const float half = static_cast<float>(side) / 2.0f;
+    const float *coordinates = reinterpret_cast<const float *>(points->data());
+    const size_t count = points->size() / (2 * sizeof(float));
+    for (size_t i = 0; i < count; i++)
+    {
+      const int32_t x = static_cast<int32_t>(std::lround(coordinates[2 * i] - half));
+      const int32_t y = static_cast<int32_t>(std::lround(coordinates[2 * i + 1] - half));
+      fillRect(data, bitmapData.width, bitmapData.height, bitmapData.channels, x, y, x + side, y + side, pixel);
+    }
+  }
+
+  const HFImageBitmapData &HybridImageBitmap::getNativeData() const
+  {
+    if (_header.data == nullptr)
+    {
+      throw std::runtime_error("HybridImageBitmap is not initialized");
+    }
+    return _header;
+  }
+
+  uint8_t *HybridImageBitmap::getWritableData()
+  {
+    // Memory allocated for this bitmap needs no native copy, only the native draw calls do
+    if (_adopted == nullptr || !_writable)
+    {
+      makeWritable();
+    }
+    return getNativeData().data;
+  }
+
+  std::shared_ptr<HybridImageBitmapSpec> HybridImageBitmap::crop(const FaceRect &rect)
+  {
+    ImageTransform transform;
+    transform.rect = rect;
+    return createTransformed(getNativeData(), transform);
+  }
+
+  std::shared_ptr<HybridImageBitmapSpec> HybridImageBitmap::resize(double width, double height, std::optional<Interpolation> interpolation)
+  {
+    ImageTransform transform;
+    transform.width = width;
+    transform.height = height;
+    transform.interpolation = interpolation;
+    return createTransformed(getNativeData(), transform);
+  }
+
+  std::shared_ptr<HybridImageBitmapSpec> HybridImageBitmap::convert(ImageFormat format)
+  {
+    ImageTransform transform;
+    transform.format = format;
+    return createTransformed(getNativeData(), transform);
+  }
+
+  std::shared_ptr<HybridImageBitmapSpec> HybridImageBitmap::transform(const ImageTransform &transform)
+  {
+    return createTransformed(getNativeData(), transform);
+  }
+
+  std::shared_ptr<Promise<std::shared_ptr<ArrayBuffer>>> HybridImageBitmap::encode(ImageEncoding format, std::optional<double> quality)
+  {
+    return encodeAsync(pin(), isBorrowed(), getNativeData(), CameraRotation::ROTATION_0, format, quality);
+  }
+
+  std::shared_ptr<Promise<std::shared_ptr<ArrayBuffer>>> HybridImageBitmap::encodeAsync(std::shared_ptr<void> pin, bool borrowed, const HFImageBitmapData &source,
+                                                                                        CameraRotation rotation, ImageEncoding format, std::optional<double> quality)
+  {
+    if (source.channels != 1 && source.channels != 3 && source.channels != 4)
+    {
+      throw std::runtime_error("Unsupported number of channels: " + std::to_string(source.channels));
+    }
+
+    // The platform encoders take RGBA, the swizzle and the rotation run in the same pass
+    PixelTransform pixels;
+    pixels.width = source.width;
+    pixels.height = source.height;
+    pixels.rotation = static_cast<int32_t>(rotation);
+    const bool quarterTurn = pixels.rotation == 1 || pixels.rotation == 3;
+    pixels.dstWidth = quarterTurn ? source.height : source.width;
+    pixels.dstHeight = quarterTurn ? source.width : source.height;
+    pixels.dstChannels = channelMapForFormat(ImageFormat::RGBA, source.channels, pixels.channelMap);
+    pixels.resampling = Resampling::Nearest;
+
+    auto codec = platformCodec();
+    const double jpegQuality = std::clamp(std::round(quality.value_or(kDefaultQuality)), 0.0, 100.0);
+    if (borrowed)
+    {
+      // JS memory may only be read on the JS thread, the swizzle runs here and only the encoder moves to the worker
+      auto rgba = ArrayBuffer::allocate(static_cast<size_t>(pixels.dstWidth) * pixels.dstHeight * 4);
+      transformImage(source.data, source.width, source.height, source.channels, pixels, rgba->data());
+      return Promise<std::shared_ptr<ArrayBuffer>>::async([codec, rgba, pixels, format, jpegQuality]() -> std::shared_ptr<ArrayBuffer>
+      {
+        return codec->encodeImage(rgba, pixels.dstWidth, pixels.dstHeight, format, jpegQuality);
+      });
+    }
+    return Promise<std::shared_ptr<ArrayBuffer>>::async([codec, pin, source, pixels, format, jpegQuality]() -> std::shared_ptr<ArrayBuffer>
+    {
+      auto rgba = ArrayBuffer::allocate(static_cast<size_t>(pixels.dstWidth) * pixels.dstHeight * 4);
+      transformImage(source.data, source.width, source.height, source.channels, pixels, rgba->data());
+      return codec->encodeImage(rgba, pixels.dstWidth, pixels.dstHeight, format, jpegQuality);
+    });
+  }
+
+  std::shared_ptr<HybridImageBitmap> HybridImageBitmap::createTransformed(const HFImageBitmapData &source, const ImageTransform &transform,
+                                                                          CameraRotation defaultRotation)
+  {
+    if (source.channels != 1 && source.channels != 3 && source.channels != 4)
+    {
+      throw std::runtime_error("Unsupported number of channels: " + std::to_string(source.channels));
+    }
+
+    PixelTransform pixels;
+    if (transform.rect.has_value())
+    {
+      // Clamp the region to the image
+      const FaceRect &rect = transform.rect.value();
+      pixels.x = std::clamp(static_cast<int32_t>(rect.x), 0, source.width);
+      pixels.y = std::clamp(static_cast<int32_t>(rect.y), 0, source.height);
+      pixels.width = std::clamp(static_cast<int32_t>(rect.x + rect.width), pixels.x, source.width) - pixels.x;
+      pixels.height = std::clamp(static_cast<int32_t>(rect.y + rect.height), pixels.y, source.height) - pixels.y;
+    }
+    else
+    {
+      pixels.width = source.width;
+      pixels.height = source.height;
+    }
+    if (pixels.width <= 0 || pixels.height <= 0)
+    {
+      throw std::runtime_error("Region is outside of the image");
+    }
+
+    pixels.rotation = static_cast<int32_t>(transform.rotation.value_or(defaultRotation));
+    const bool quarterTurn = pixels.rotation == 1 || pixels.rotation == 3;
+    const int32_t rotatedWidth = quarterTurn ? pixels.height : pixels.width;
+    const int32_t rotatedHeight = quarterTurn ? pixels.width : pixels.height;
+
+    // A single given side keeps the aspect ratio of the region
+    if (transform.width.has_value() && transform.height.has_value())
+    {
+      pixels.dstWidth = static_cast<int32_t>(std::lround(transform.width.value()));
+      pixels.dstHeight = static_cast<int32_t>(std::lround(transform.height.value()));
+    }
+    else if (transform.width.has_value())
+    {
+      pixels.dstWidth = static_cast<int32_t>(std::lround(transform.width.value()));
+      pixels.dstHeight = static_cast<int32_t>(std::lround(transform.width.value() * rotatedHeight / rotatedWidth));
+    }
+    else if (transform.height.has_value())
+    {
+      pixels.dstHeight = static_cast<int32_t>(std::lround(transform.height.value()));
+      pixels.dstWidth = static_cast<int32_t>(std::lround(transform.height.value() * rotatedWidth / rotatedHeight));
+    }
+    else
+    {
+      pixels.dstWidth = rotatedWidth;
+      pixels.dstHeight = rotatedHeight;
+    }
+    if (pixels.dstWidth <= 0 || pixels.dstHeight <= 0)
+    {
+      throw std::runtime_error("Invalid bitmap size: " + std::to_string(pixels.dstWidth) + "x" + std::to_string(pixels.dstHeight));
+    }
+
+    if (transform.interpolation.has_value())
+    {
+      // Both enums list the same modes in the same order
+      pixels.resampling = static_cast<Resampling>(transform.interpolation.value());
+    }
+    else
+    {
+      pixels.resampling = pixels.dstWidth <= rotatedWidth && pixels.dstHeight <= rotatedHeight ? Resampling::Area : Resampling::Bilinear;
+    }
+
+    if (transform.format.has_value())
+    {
+      pixels.dstChannels = channelMapForFormat(transform.format.value(), source.channels, pixels.channelMap);
+    }
+    else
+    {
+      pixels.dstChannels = source.channels;
+    }
+
+    std::vector<uint8_t> buffer(static_cast<size_t>(pixels.dstWidth) * pixels.dstHeight * pixels.dstChannels);
+    transformImage(source.data, source.width, source.height, source.channels, pixels, buffer.data());
+
+    HFImageBitmapData bitmapData{};
+    bitmapData.data = buffer.data();
+    bitmapData.width = pixels.dstWidth;
+    bitmapData.height = pixels.dstHeight;
+    bitmapData.channels = pixels.dstChannels;
+    HFImageBitmap bitmap = nullptr;
+    HResult result = HFCreateImageBitmap(&bitmapData, &bitmap);
+    if (result != HSUCCEED || bitmap == nullptr)
+    {
+      throw std::runtime_error("Failed to create image bitmap with error code: " + std::to_string(result));
+    }
+    return std::make_shared<HybridImageBitmap>(bitmap);
+  }
 } // namespace margelo::nitro::nitroinspireface
@@ -6,10 +6,21 @@
 #include "Color.hpp"
 #include "Point2f.hpp"
 #include "Point2i.hpp"
+#include "FaceData.hpp"
+#include "OverlayStyle.hpp"
+#include "ImageFormat.hpp"
+#include "ImageTransform.hpp"
+#include "Interpolation.hpp"
+#include "CameraRotation.hpp"
+#include "ImageEncoding.hpp"
 #include <NitroModules/ArrayBuffer.hpp>
 #include <NitroModules/NitroLogger.hpp>
+#include <NitroModules/Promise.hpp>
+#include <cstdint>
 #include <memory>
+#include <optional>
 #include <string>
+#include <vector>
 
 namespace margelo::nitro::nitroinspireface
 {
@@ -25,6 +36,9 @@ namespace margelo::nitro::nitroinspireface
     // Constructor with bitmap
     HybridImageBitmap(HFImageBitmap bitmap);
 
+    // Constructor adopting memory, read-only until a draw call copies it unless the memory was allocated for this bitmap
+    HybridImageBitmap(std::shared_ptr<ArrayBuffer> buffer, int32_t width, int32_t height, int32_t channels, bool writable = false);
+
     // Destructor
     ~HybridImageBitmap() override;
 
@@ -47,11 +61,53 @@ namespace margelo::nitro::nitroinspireface
     void drawRect(const FaceRect &rect, const Color &color, double thickness) override;
     void drawCircleF(const Point2f &point, double radius, const Color &color, double thickness) override;
     void drawCircle(const Point2i &point, double radius, const Color &color, double thickness) override;
+    void drawFaces(const std::vector<FaceData> &faces, const OverlayStyle &style, const std::optional<std::shared_ptr<ArrayBuffer>> &landmarks) override;
+    void drawPoints(const std::shared_ptr<ArrayBuffer> &points, const Color &color, std::optional<double> size) override;
+    std::shared_ptr<HybridImageBitmapSpec> crop(const FaceRect &rect) override;
+    std::shared_ptr<HybridImageBitmapSpec> resize(double width, double height, std::optional<Interpolation> interpolation) override;
+    std::shared_ptr<HybridImageBitmapSpec> convert(ImageFormat format) override;
+    std::shared_ptr<HybridImageBitmapSpec> transform(const ImageTransform &transform) override;
+    std::shared_ptr<Promise<std::shared_ptr<ArrayBuffer>>> encode(ImageEncoding format, std::optional<double> quality) override;
+
+    // Apply a transform to bitmap data in a single pass and wrap the result in a new bitmap
+    static std::shared_ptr<HybridImageBitmap> createTransformed(const HFImageBitmapData &source, const ImageTransform &transform,
+                                                                CameraRotation defaultRotation = CameraRotation::ROTATION_0);
+
+    // Compress bitmap data on a worker thread, pin keeps the pixels alive until the encoder is done.
+    // Borrowed JS memory is converted on the calling thread, the worker never reads it
+    static std::shared_ptr<Promise<std::shared_ptr<ArrayBuffer>>> encodeAsync(std::shared_ptr<void> pin, bool borrowed, const HFImageBitmapData &source,
+                                                                              CameraRotation rotation, ImageEncoding format, std::optional<double> quality);
+
+    // Get the native bitmap handle, nullptr for adopted memory
+    HFImageBitmap getNativeHandle() const { return _bitmap.get(); }
+
+    // Whether the pixels are adopted caller memory rather than a native bitmap
+    bool isAdopted() const { return _adopted != nullptr; }
 
-    // Get the native bitmap handle
-    HFImageBitmap getNativeHandle() const { return _bitmap; }
+    // Whether the pixels are JS memory, which may only be read synchronously on the JS thread
+    bool isBorrowed() const { return _adopted != nullptr && !_adopted->isOwner(); }
+
+    // Keep the pixel memory alive, also after dispose
+    std::shared_ptr<void> pin() const;
+
+    // Cached header of the bitmap, throws once disposed
+    const HFImageBitmapData &getNativeData() const;
+
+    // Pixels to write into, adopted memory is copied first like before a draw call
+    uint8_t *getWritableData();
+
+  private:
+    // Read the header once, the size and data pointer of a bitmap never change
+    void loadHeader();
+    // Copy adopted memory into a native bitmap before the pixels are changed
+    void makeWritable();
 
   private:
-    HFImageBitmap _bitmap;
+    // Shared with the data views, so the memory outlives dispose while a view is held
+    std::shared_ptr<void> _bitmap;
+    std::shared_ptr<ArrayBuffer> _adopted;
+    // The adopted memory is owned by this bitmap alone and is written in place
+    bool _writable = false;
+    HFImageBitmapData _header{};
   };
 } // namespace margelo::nitro::nitroinspireface
@@ -1,8 +1,11 @@
 #include "HybridImageStream.hpp"
 #include "HybridImageBitmap.hpp"
+#include "ImageKernels.hpp"
 #include <stdexcept>
 #include <string>
 #include <optional>
+#include <utility>
+#include <algorithm>
 
 namespace margelo::nitro::nitroinspireface
 {
@@ -12,13 +15,26 @@ namespace margelo::nitro::nitroinspireface
   {
   }
 
+  HybridImageStream::HybridImageStream(HFImageStream stream, std::shared_ptr<HybridImageBitmap> source, HFRotation rotation)
+      : HybridObject(TAG), _stream(stream), _rotation(rotation)
+  {
+    if (source)
+    {
+      _sourceData = source->getNativeData();
+      _sourcePin = source->pin();
+      _sourceBorrowed = source->isBorrowed();
+    }
+  }
+
   void HybridImageStream::cleanup()
   {
+    releaseRoi();
     if (_stream != nullptr)
     {
       HFReleaseImageStream(_stream);
       _stream = nullptr;
     }
+    _sourcePin.reset();
   }
 
   HybridImageStream::~HybridImageStream()
@@ -31,6 +47,39 @@ namespace margelo::nitro::nitroinspireface
     cleanup();
   }
 
+  const HFImageBitmapData *HybridImageStream::getSourceData() const
+  {
+    return _sourcePin != nullptr ? &_sourceData : nullptr;
+  }
+
+  const HFImageBitmapData *HybridImageStream::getUprightData(std::vector<uint8_t> &buffer, HFImageBitmapData &upright) const
+  {
+    const HFImageBitmapData *source = getSourceData();
+    if (source == nullptr || _rotation == HF_CAMERA_ROTATION_0)
+    {
+      return source;
+    }
+
+    // Quarter turns only move pixels, nearest sampling copies them exactly
+    PixelTransform pixels;
+    pixels.width = source->width;
+    pixels.height = source->height;
+    pixels.rotation = static_cast<int32_t>(_rotation);
+    const bool quarterTurn = pixels.rotation == 1 || pixels.rotation == 3;
+    pixels.dstWidth = quarterTurn ? source->height : source->width;
+    pixels.dstHeight = quarterTurn ? source->width : source->height;
+    pixels.dstChannels = source->channels;
+    pixels.resampling = Resampling::Nearest;
+    buffer.resize(static_cast<size_t>(pixels.dstWidth) * pixels.dstHeight * pixels.dstChannels);
+    transformImage(source->data, source->width, source->height, source->channels, pixels, buffer.data());
+
+    upright.data = buffer.data();
+    upright.width = pixels.dstWidth;
+    upright.height = pixels.dstHeight;
+    upright.channels = source->channels;
+    return &upright;
+  }
+
   void HybridImageStream::writeImageToFile(const std::string &filePath)
   {
     if (_stream == nullptr)
@@ -91,6 +140,11 @@ namespace margelo::nitro::nitroinspireface
       throw std::runtime_error("HybridImageStream is not initialized");
     }
 
+    if (_roiStream != nullptr && rotation != CameraRotation::ROTATION_0)
+    {
+      throw std::runtime_error("Rotation is not supported together with a region of interest");
+    }
+
     HFRotation nativeRotation;
     switch (rotation)
     {
@@ -115,6 +169,7 @@ namespace margelo::nitro::nitroinspireface
     {
       throw std::runtime_error("Failed to set image rotation with error code: " + std::to_string(result));
     }
+    _rotation = nativeRotation;
   }
 
   std::shared_ptr<HybridImageBitmapSpec> HybridImageStream::createImageBitmap(std::optional<bool> isRotate, std::optional<double> scale)
@@ -139,4 +194,120 @@ namespace margelo::nitro::nitroinspireface
     return std::make_shared<HybridImageBitmap>(bitmap);
   }
 
+  std::shared_ptr<HybridImageBitmapSpec> HybridImageStream::transform(const ImageTransform &transform)
+  {
+    const HFImageBitmapData *frame = getSourceData();
+    if (frame == nullptr)
+    {
+      throw std::runtime_error("Image stream was not created from a bitmap");
+    }
+    return HybridImageBitmap::createTransformed(*frame, transform, static_cast<CameraRotation>(_rotation));
+  }
+
+  std::shared_ptr<Promise<std::shared_ptr<ArrayBuffer>>> HybridImageStream::encode(ImageEncoding format, std::optional<double> quality)
+  {
+    // Bitmap sources are encoded straight from their pixels
+    const HFImageBitmapData *frame = getSourceData();
+    if (frame != nullptr)
+    {
+      return HybridImageBitmap::encodeAsync(_sourcePin, _sourceBorrowed, *frame, static_cast<CameraRotation>(_rotation), format, quality);
+    }
+
+    // Other streams, e.g. YUV camera buffers, are converted to an upright bitmap first
+    auto bitmap = std::dynamic_pointer_cast<HybridImageBitmap>(createImageBitmap(true, 1.0));
+    return HybridImageBitmap::encodeAsync(bitmap->pin(), false, bitmap->getNativeData(), CameraRotation::ROTATION_0, format, quality);
+  }
+
+  std::optional<FaceRect> HybridImageStream::getRoi()
+  {
+    if (_roiStream == nullptr)
+    {
+      return std::nullopt;
+    }
+    return FaceRect(_roiX, _roiY, _roiWidth, _roiHeight);
+  }
+
+  void HybridImageStream::setRoi(const std::optional<FaceRect> &roi)
+  {
+    if (_stream == nullptr)
+    {
+      throw std::runtime_error("HybridImageStream is not initialized");
+    }
+    releaseRoi();
+    if (!roi.has_value())
+    {
+      return;
+    }
+
+    const HFImageBitmapData *source = getSourceData();
+    if (source == nullptr)
+    {
+      throw std::runtime_error("A region of interest needs an image stream created from a bitmap");
+    }
+    if (_rotation != HF_CAMERA_ROTATION_0)
+    {
+      throw std::runtime_error("Rotation is not supported together with a region of interest");
+    }
+
+    const HFImageBitmapData &frame = *source;
+    if (frame.channels != 3)
+    {
+      throw std::runtime_error("A region of interest needs a 3 channel bitmap, got " + std::to_string(frame.channels));
+    }
+
+    // Clamp the region to the frame
+    const int32_t left = std::clamp(static_cast<int32_t>(roi->x), 0, frame.width);
+    const int32_t top = std::clamp(static_cast<int32_t>(roi->y), 0, frame.height);
+    const int32_t right = std::clamp(static_cast<int32_t>(roi->x + roi->width), left, frame.width);
+    const int32_t bottom = std::clamp(static_cast<int32_t>(roi->y + roi->height), top, frame.height);
+    if (right - left < 16 || bottom - top < 16)
+    {
+      throw std::runtime_error("Region of interest is too small");
+    }
+
+    HFImageData image = {};
+    image.width = right - left;
+    image.height = bottom - top;
+    image.format = HF_STREAM_BGR;
+    image.rotation = HF_CAMERA_ROTATION_0;
+    const size_t stride = static_cast<size_t>(frame.width) * 3;
+    if (image.width == frame.width)
+    {
+      // Full-width regions are contiguous rows of the frame, view them in place
+      image.data = frame.data + static_cast<size_t>(top) * stride;
+    }
+    else
+    {
+      _roiBuffer.resize(static_cast<size_t>(image.width) * image.height * 3);
+      copyRegion(frame.data, frame.width, 3, left, top, image.width, image.height, _roiBuffer.data());
+      image.data = _roiBuffer.data();
+    }
+
+    HResult result = HFCreateImageStream(&image, &_roiStream);
+    if (result != HSUCCEED || _roiStream == nullptr)
+    {
+      _roiStream = nullptr;
+      _roiBuffer.clear();
+      throw std::runtime_error("Failed to create region of interest stream with error code: " + std::to_string(result));
+    }
+    _roiX = left;
+    _roiY = top;
+    _roiWidth = image.width;
+    _roiHeight = image.height;
+  }
+
+  void HybridImageStream::releaseRoi()
+  {
+    if (_roiStream != nullptr)
+    {
+      HFReleaseImageStream(_roiStream);
+      _roiStream = nullptr;
+    }
+    _roiBuffer.clear();
+    _roiX = 0;
+    _roiY = 0;
+    _roiWidth = 0;
+    _roiHeight = 0;
+  }
+
 } // namespace margelo::nitro::nitroinspireface
@@ -5,8 +5,15 @@
 #include "ImageFormat.hpp"
 #include "CameraRotation.hpp"
 #include "HybridImageBitmapSpec.hpp"
+#include "FaceRect.hpp"
+#include "ImageTransform.hpp"
+#include "ImageEncoding.hpp"
+#include <NitroModules/ArrayBuffer.hpp>
+#include <NitroModules/Promise.hpp>
+#include <cstdint>
 #include <memory>
 #include <optional>
+#include <vector>
 
 namespace margelo::nitro::nitroinspireface
 {
@@ -24,6 +31,9 @@ namespace margelo::nitro::nitroinspireface
     // Constructor with stream
     HybridImageStream(HFImageStream stream);
 
+    // Constructor with stream and the bitmap holding its pixels, kept alive with the stream
+    HybridImageStream(HFImageStream stream, std::shared_ptr<HybridImageBitmap> source, HFRotation rotation = HF_CAMERA_ROTATION_0);
+
     // Destructor
     ~HybridImageStream() override;
 
@@ -35,17 +45,53 @@ namespace margelo::nitro::nitroinspireface
     void cleanup();
 
   public:
+    // Properties
+    std::optional<FaceRect> getRoi() override;
+
     // Methods
     void writeImageToFile(const std::string &filePath) override;
     void setFormat(ImageFormat format) override;
     void setRotation(CameraRotation rotation) override;
     std::shared_ptr<HybridImageBitmapSpec> createImageBitmap(std::optional<bool> isRotate = std::nullopt, std::optional<double> scale = std::nullopt) override;
+    void setRoi(const std::optional<FaceRect> &roi) override;
+    std::shared_ptr<HybridImageBitmapSpec> transform(const ImageTransform &transform) override;
+    std::shared_ptr<Promise<std::shared_ptr<ArrayBuffer>>> encode(ImageEncoding format, std::optional<double> quality) override;
+
+    // Get the native stream handle, the region of interest when one is set
+    HFImageStream getNativeHandle() const { return _roiStream != nullptr ? _roiStream : _stream; }
+
+    // Offset of the region of interest in the frame, 0 without one
+    int32_t getRoiX() const { return _roiStream != nullptr ? _roiX : 0; }
+    int32_t getRoiY() const { return _roiStream != nullptr ? _roiY : 0; }
+    // Size of the region of interest, 0 without one
+    int32_t getRoiWidth() const { return _roiStream != nullptr ? _roiWidth : 0; }
+    int32_t getRoiHeight() const { return _roiStream != nullptr ? _roiHeight : 0; }
 
-    // Get the native stream handle
-    HFImageStream getNativeHandle() const { return _stream; }
+    // Header of the source bitmap, nullptr when unknown
+    const HFImageBitmapData *getSourceData() const;
+
+    // Source bitmap turned by the stream rotation, rotated pixels go to buffer. nullptr when unknown
+    const HFImageBitmapData *getUprightData(std::vector<uint8_t> &buffer, HFImageBitmapData &upright) const;
+
+  private:
+    void releaseRoi();
 
   private:
     HFImageStream _stream;
+    // Pixels of the source bitmap, pinned so the stream never outlives them
+    std::shared_ptr<void> _sourcePin;
+    HFImageBitmapData _sourceData{};
+    // Source pixels are JS memory, only to be read on the JS thread
+    bool _sourceBorrowed = false;
+    HFRotation _rotation = HF_CAMERA_ROTATION_0;
+
+    // View of the region of interest, backed by the frame or by a copy of its rows
+    HFImageStream _roiStream = nullptr;
+    std::vector<uint8_t> _roiBuffer;
+    int32_t _roiX = 0;
+    int32_t _roiY = 0;
+    int32_t _roiWidth = 0;
+    int32_t _roiHeight = 0;
   };
 
 } // namespace margelo::nitro::nitroinspireface
@@ -1,4 +1,8 @@
 #include "HybridInspireFace.hpp"
+#include "FeatureGallery.hpp"
+#include "FeatureMigration.hpp"
+#include "GalleryAudit.hpp"
+#include "ImageKernels.hpp"
 #include "inspireface.h"
 #include <sys/stat.h>
 #include <stdexcept>
@@ -6,11 +10,133 @@
 #include <NitroModules/HybridObjectRegistry.hpp>
 #include <cstring>
 #include <memory>
+#include <mutex>
 #include <vector>
 #include <optional>
+#include <algorithm>
+#include <cmath>
+#include <utility>
 
 namespace margelo::nitro::nitroinspireface
 {
+  namespace
+  {
+    // Bitmap of an optional face crop argument, nullptr when none was given
+    std::shared_ptr<HybridImageBitmap> cropBitmap(const std::optional<std::shared_ptr<HybridImageBitmapSpec>> &crop)
+    {
+      if (!crop.has_value())
+      {
+        return nullptr;
+      }
+      auto bitmap = std::dynamic_pointer_cast<HybridImageBitmap>(crop.value());
+      if (!bitmap)
+      {
+        throw std::runtime_error("Invalid crop bitmap");
+      }
+      return bitmap;
+    }
+
+    // Store the aligned crop of an id, the caller holds hubMutex
+    bool storeCrop(int64_t id, const HybridImageBitmap &bitmap)
+    {
+      const HFImageBitmapData &data = bitmap.getNativeData();
+      return FeatureGallery::shared().saveCrop(id, data.data, data.width, data.height, data.channels);
+    }
+
+    // Stable name of a model pack, its file name without the directory it was copied to
+    std::string modelPackName(const std::string &path)
+    {
+      const size_t slash = path.find_last_of('/');
+      return slash == std::string::npos ? path : path.substr(slash + 1);
+    }
+
+    // Offset of the region of interest of a stream, 0 without a stream or region
+    std::pair<double, double> roiOffset(const std::optional<std::shared_ptr<HybridImageStreamSpec>> &imageStream)
+    {
+      auto nitroImageStream = imageStream.has_value() ? std::dynamic_pointer_cast<HybridImageStream>(imageStream.value()) : nullptr;
+      if (!nitroImageStream)
+      {
+        return {0.0, 0.0};
+      }
+      return {static_cast<double>(nitroImageStream->getRoiX()), static_cast<double>(nitroImageStream->getRoiY())};
+    }
+
+    // Decode count points of every token into one buffer of float32 x, y pairs, face after face
+    std::shared_ptr<ArrayBuffer> decodeTokenPoints(const std::vector<std::shared_ptr<ArrayBuffer>> &tokens, int32_t count, std::pair<double, double> offset,
+                                                   HResult (*decode)(HFFaceBasicToken, HPoint2f *, HInt32), const char *name)
+    {
+      static_assert(sizeof(HPoint2f) == 2 * sizeof(float), "HPoint2f must be two packed floats");
+      auto points = ArrayBuffer::allocate(tokens.size() * count * sizeof(HPoint2f));
+      HPoint2f *out = reinterpret_cast<HPoint2f *>(points->data());
+      for (size_t i = 0; i < tokens.size(); i++)
+      {
+        if (!tokens[i] || tokens[i]->size() == 0)
+        {
+          throw std::runtime_error("Invalid face token data at index " + std::to_string(i));
+        }
+        HFFaceBasicToken faceToken;
+        faceToken.size = static_cast<HInt32>(tokens[i]->size());
+        faceToken.data = reinterpret_cast<void *>(tokens[i]->data());
+        // The SDK writes straight into the result buffer
+        HResult result = decode(faceToken, out + i * count, count);
+        if (result != HSUCCEED)
+        {
+          throw std::runtime_error(std::string("Failed to get face ") + name + " with error code: " + std::to_string(result));
+        }
+      }
+
+      if (offset.first != 0.0 || offset.second != 0.0)
+      {
+        const float offsetX = static_cast<float>(offset.first);
+        const float offsetY = static_cast<float>(offset.second);
+        const size_t total = tokens.size() * count;
+        for (size_t i = 0; i < total; i++)
+        {
+          out[i].x += offsetX;
+          out[i].y += offsetY;
+        }
+      }
+      return points;
+    }
+
+    // Turn decoded RGBA pixels into a BGR or BGRA bitmap that adopts the converted pixels.
+    // Decoders only scale by powers of two, the rest of the downscale happens in the same pass
+    std::shared_ptr<HybridImageBitmap> bitmapFromDecoded(const DecodedImage &image, int32_t channels, std::optional<double> maxSize)
+    {
+      if (channels != 3 && channels != 4)
+      {
+        throw std::runtime_error("Decoded bitmaps need 3 or 4 channels, got " + std::to_string(channels));
+      }
+      const int32_t width = static_cast<int32_t>(image.width);
+      const int32_t height = static_cast<int32_t>(image.height);
+      if (!image.data || width <= 0 || height <= 0 || image.data->size() < static_cast<size_t>(width) * height * 4)
+      {
+        throw std::runtime_error("Invalid decoded image");
+      }
+
+      PixelTransform transform;
+      transform.width = width;
+      transform.height = height;
+      transform.dstWidth = width;
+      transform.dstHeight = height;
+      const double longest = static_cast<double>(std::max(width, height));
+      if (maxSize.has_value() && maxSize.value() > 0 && longest > maxSize.value())
+      {
+        const double scale = maxSize.value() / longest;
+        transform.dstWidth = std::max<int32_t>(1, static_cast<int32_t>(std::lround(width * scale)));
+        transform.dstHeight = std::max<int32_t>(1, static_cast<int32_t>(std::lround(height * scale)));
+        transform.resampling = Resampling::Area;
+      }
+      transform.dstChannels = channels;
+      const uint8_t bgra[4] = {2, 1, 0, 3};
+      std::copy(bgra, bgra + 4, transform.channelMap);
+
+      auto pixels = ArrayBuffer::allocate(static_cast<size_t>(transform.dstWidth) * transform.dstHeight * channels);
+      transformImage(image.data->data(), width, height, 4, transform, pixels->data());
+      return std::make_shared<HybridImageBitmap>(pixels, transform.dstWidth, transform.dstHeight, channels, true);
+    }
+  } // namespace
+
   HybridInspireFace::HybridInspireFace() : HybridObject(TAG)
   {
     auto utilsObject = HybridObjectRegistry::createHybridObject("AssetManager");
@@ -59,6 +185,8 @@ namespace margelo::nitro::nitroinspireface
         Logger::log(LogLevel::Error, TAG, "Failed to launch HybridInspireFace SDK with error code: %ld", result);
         throw std::runtime_error("Failed to launch HybridInspireFace SDK");
       }
+      cachedDenseLandmarkCount.store(0, std::memory_order_relaxed);
+      FeatureGallery::shared().setModelTag(modelPackName(path));
     }
     catch (const std::exception &e)
     {
@@ -75,6 +203,8 @@ namespace margelo::nitro::nitroinspireface
       Logger::log(LogLevel::Error, TAG, "Failed to reload InspireFace with error code: %ld", result);
       throw std::runtime_error("Failed to reload InspireFace");
     }
+    cachedDenseLandmarkCount.store(0, std::memory_order_relaxed);
+    FeatureGallery::shared().setModelTag(modelPackName(path));
   }
 
   void HybridInspireFace::terminate()
@@ -85,6 +215,7 @@ namespace margelo::nitro::nitroinspireface
       Logger::log(LogLevel::Error, TAG, "Failed to terminate InspireFace with error code: %ld", result);
       throw std::runtime_error("Failed to terminate InspireFace");
     }
+    cachedDenseLandmarkCount.store(0, std::memory_order_relaxed);
   }
 
   void HybridInspireFace::featureHubDataEnable(const FeatureHubConfiguration &config)
@@ -112,6 +243,13 @@ namespace margelo::nitro::nitroinspireface
       Logger::log(LogLevel::Error, TAG, "Failed to enable feature hub data with error code: %ld", result);
       throw std::runtime_error("Failed to enable feature hub data");
     }
+
+    FeatureGallery::shared().open(destPath, config.enablePersistence);
+    FeatureGallery::shared().configureSearch(
+        config.enableFrequencyOrdering.value_or(false),
+        config.searchMode == SearchMode::EAGER,
+        static_cast<float>(config.searchThreshold),
+        static_cast<int32_t>(config.reorderInterval.value_or(256)));
   }
 
   void HybridInspireFace::featureHubFaceSearchThresholdSetting(double threshold)
@@ -122,6 +260,7 @@ namespace margelo::nitro::nitroinspireface
       Logger::log(LogLevel::Error, TAG, "Failed to set feature hub face search threshold with error code: %ld", result);
       throw std::runtime_error("Failed to set feature hub face search threshold");
     }
+    FeatureGallery::shared().setSearchThreshold(static_cast<float>(threshold));
   }
 
   std::shared_ptr<HybridSessionSpec> HybridInspireFace::createSession(
@@ -158,6 +297,59 @@ namespace margelo::nitro::nitroinspireface
     return std::make_shared<HybridSession>(session);
   }
 
+  std::shared_ptr<HybridFaceClustererSpec> HybridInspireFace::createFaceClusterer(const FaceClustererConfig &config)
+  {
+    return std::make_shared<HybridFaceClusterer>(
+        static_cast<float>(config.threshold),
+        static_cast<int32_t>(config.neighborCount.value_or(10)),
+        static_cast<int32_t>(config.iterations.value_or(20)));
+  }
+
+  std::shared_ptr<HybridVisitorCounterSpec> HybridInspireFace::createVisitorCounter(const VisitorCounterConfig &config)
+  {
+    return std::make_shared<HybridVisitorCounter>(
+        static_cast<float>(config.threshold),
+        static_cast<int32_t>(config.maxCentroids.value_or(256)),
+        config.halfLife.value_or(60000.0),
+        config.retention.value_or(3600000.0));
+  }
+
+  std::shared_ptr<HybridTiledDetectorSpec> HybridInspireFace::createTiledDetector(const TiledDetectorConfig &config)
+  {
+    // Tiles only need the detector, every other module stays unloaded
+    HFSessionCustomParameter hfParam = {};
+    const int32_t workerCount = std::max<int32_t>(1, static_cast<int32_t>(config.workerCount.value_or(1)));
+    std::vector<HFSession> sessions;
+    sessions.reserve(workerCount);
+    for (int32_t i = 0; i < workerCount; i++)
+    {
+      HFSession session = nullptr;
+      HResult result = HFCreateInspireFaceSession(
+          hfParam,
+          HF_DETECT_MODE_ALWAYS_DETECT,
+          static_cast<HInt32>(config.maxDetectFaceNum.value_or(20)),
+          static_cast<HInt32>(config.detectPixelLevel.value_or(320)),
+          -1,
+          &session);
+      if (result != HSUCCEED || session == nullptr)
+      {
+        for (HFSession created : sessions)
+        {
+          HFReleaseInspireFaceSession(created);
+        }
+        throw std::runtime_error("Failed to create session with error code: " + std::to_string(result));
+      }
+      sessions.push_back(session);
+    }
+
+    return std::make_shared<HybridTiledDetector>(
+        std::move(sessions),
+        static_cast<int32_t>(config.tileSize.value_or(640)),
+        static_cast<float>(config.overlap.value_or(0.25)),
+        config.includeFullFrame.value_or(true),
+        static_cast<float>(config.iouThreshold.value_or(0.4)));
+  }
+
   std::shared_ptr<HybridImageBitmapSpec> HybridInspireFace::createImageBitmapFromFilePath(double channels, const std::string &filePath)
   {
     HFImageBitmap bitmap = nullptr;
@@ -170,8 +362,19 @@ namespace margelo::nitro::nitroinspireface
     return std::make_shared<HybridImageBitmap>(bitmap);
   }
 
-  std::shared_ptr<HybridImageBitmapSpec> HybridInspireFace::createImageBitmapFromBuffer(const std::shared_ptr<ArrayBuffer> &buffer, double width, double height, double channels)
+  std::shared_ptr<HybridImageBitmapSpec> HybridInspireFace::createImageBitmapFromBuffer(const std::shared_ptr<ArrayBuffer> &buffer, double width, double height, double channels, std::optional<bool> adopt)
   {
+    if (adopt.value_or(false))
+    {
+      const size_t expected = static_cast<size_t>(width) * static_cast<size_t>(height) * static_cast<size_t>(channels);
+      if (!buffer || buffer->data() == nullptr || buffer->size() < expected)
+      {
+        throw std::runtime_error("Invalid buffer size. Expected at least " + std::to_string(expected) + " bytes");
+      }
+      // The bitmap retains the buffer and reads it in place
+      return std::make_shared<HybridImageBitmap>(buffer, static_cast<int32_t>(width), static_cast<int32_t>(height), static_cast<int32_t>(channels));
+    }
+
     // Create bitmap data structure
     HFImageBitmapData bitmapData{};
     bitmapData.data = reinterpret_cast<uint8_t *>(buffer->data());
@@ -190,6 +393,30 @@ namespace margelo::nitro::nitroinspireface
     return std::make_shared<HybridImageBitmap>(bitmap);
   }
 
+  std::shared_ptr<HybridImageBitmapSpec> HybridInspireFace::createImageBitmapFromEncoded(const std::shared_ptr<ArrayBuffer> &buffer, double channels, std::optional<double> maxSize)
+  {
+    if (!buffer || buffer->size() == 0)
+    {
+      throw std::runtime_error("Invalid image data");
+    }
+    return bitmapFromDecoded(assetManager->decodeImage(buffer, maxSize), static_cast<int32_t>(channels), maxSize);
+  }
+
+  std::shared_ptr<Promise<std::shared_ptr<HybridImageBitmapSpec>>> HybridInspireFace::createImageBitmapFromEncodedAsync(const std::shared_ptr<ArrayBuffer> &buffer, double channels, std::optional<double> maxSize)
+  {
+    if (!buffer || buffer->size() == 0)
+    {
+      throw std::runtime_error("Invalid image data");
+    }
+    // JS buffers can only be read on the JS thread, the encoded bytes are small next to the pixels
+    auto encoded = ArrayBuffer::copy(buffer->data(), buffer->size());
+    auto decoder = assetManager;
+    return Promise<std::shared_ptr<HybridImageBitmapSpec>>::async([decoder, encoded, channels, maxSize]() -> std::shared_ptr<HybridImageBitmapSpec>
+    {
+      return bitmapFromDecoded(decoder->decodeImage(encoded, maxSize), static_cast<int32_t>(channels), maxSize);
+    });
+  }
+
   std::shared_ptr<HybridImageStreamSpec> HybridInspireFace::createImageStreamFromBitmap(const std::shared_ptr<HybridImageBitmapSpec> &bitmap, CameraRotation rotation)
   {
     if (!bitmap)
@@ -203,37 +430,45 @@ namespace margelo::nitro::nitroinspireface
       throw std::runtime_error("Failed to cast to HybridImageBitmap");
     }
 
-    // Create stream from bitmap
+    // Create stream from bitmap, adopted memory is viewed directly as BGR or BGRA
     HFImageStream stream = nullptr;
-    HResult result = HFCreateImageStreamFromImageBitmap(
-        nitroBitmap->getNativeHandle(),
-        static_cast<HFRotation>(rotation),
-        &stream);
+    HResult result = HSUCCEED;
+    if (nitroBitmap->isAdopted())
+    {
+      const HFImageBitmapData &bitmapData = nitroBitmap->getNativeData();
+      if (bitmapData.channels != 3 && bitmapData.channels != 4)
+      {
+        throw std::runtime_error("Adopted bitmaps need 3 or 4 channels, got " + std::to_string(bitmapData.channels));
+      }
+      HFImageData imageData = {};
+      imageData.data = bitmapData.data;
+      imageData.width = bitmapData.width;
+      imageData.height = bitmapData.height;
+      imageData.format = bitmapData.channels == 4 ? HF_STREAM_BGRA : HF_STREAM_BGR;
+      imageData.rotation = static_cast<HFRotation>(rotation);
+      result = HFCreateImageStream(&imageData, &stream);
+    }
+    else
+    {
+      result = HFCreateImageStreamFromImageBitmap(
+          nitroBitmap->getNativeHandle(),
+          static_cast<HFRotation>(rotation),
+          &stream);
+    }
 
     if (result != HSUCCEED || stream == nullptr)
     {
       throw std::runtime_error("Failed to create image stream from bitmap with error code: " + std::to_string(result));
     }
 
-    return std::make_shared<HybridImageStream>(stream);
+    // The stream reads the pixels of the bitmap, keep it alive as long as the stream
+    return std::make_shared<HybridImageStream>(stream, nitroBitmap, static_cast<HFRotation>(rotation));
   }
 
-  std::vector<Point2f> HybridInspireFace::getFaceDenseLandmarkFromFaceToken(const std::shared_ptr<ArrayBuffer> &token, std::optional<double> num)
+  std::vector<Point2f> HybridInspireFace::getFaceDenseLandmarkFromFaceToken(const std::shared_ptr<ArrayBuffer> &token, std::optional<double> num, const std::optional<std::shared_ptr<HybridImageStreamSpec>> &imageStream)
   {
     // Get the number of landmarks from the HybridInspireFace API if not provided
-    int32_t numLandmarks = 0;
-    if (num.has_value())
-    {
-      numLandmarks = static_cast<int32_t>(num.value());
-    }
-    else
-    {
-      HResult result = HFGetNumOfFaceDenseLandmark(&numLandmarks);
-      if (result != HSUCCEED || numLandmarks <= 0)
-      {
-        throw std::runtime_error("Failed to get number of face landmarks with error code: " + std::to_string(result));
-      }
-    }
+    const int32_t numLandmarks = num.has_value() ? static_cast<int32_t>(num.value()) : denseLandmarkCount();
 
     // Create the HFFaceBasicToken structure from our token
     HFFaceBasicToken faceToken;
@@ -256,21 +491,22 @@ namespace margelo::nitro::nitroinspireface
       throw std::runtime_error("Failed to get face dense landmarks with error code: " + std::to_string(result));
     }
 
-    // Convert to Point2f vector
+    // Convert to Point2f vector, in frame coordinates when the face was tracked on a region of interest
+    const auto [offsetX, offsetY] = roiOffset(imageStream);
     std::vector<Point2f> landmarkPoints;
     landmarkPoints.reserve(numLandmarks);
 
     for (int i = 0; i < numLandmarks; i++)
     {
       landmarkPoints.emplace_back(
-          static_cast<double>(landmarks[i].x),
-          static_cast<double>(landmarks[i].y));
+          static_cast<double>(landmarks[i].x) + offsetX,
+          static_cast<double>(landmarks[i].y) + offsetY);
     }
 
     return landmarkPoints;
   }
 
-  std::vector<Point2f> HybridInspireFace::getFaceFiveKeyPointsFromFaceToken(const std::shared_ptr<ArrayBuffer> &token, std::optional<double> num)
+  std::vector<Point2f> HybridInspireFace::getFaceFiveKeyPointsFromFaceToken(const std::shared_ptr<ArrayBuffer> &token, std::optional<double> num, const std::optional<std::shared_ptr<HybridImageStreamSpec>> &imageStream)
   {
     // Default to 5 key points if not specified
     int32_t numKeyPoints = num.has_value() ? static_cast<int32_t>(num.value()) : 5;
@@ -296,22 +532,34 @@ namespace margelo::nitro::nitroinspireface
       throw std::runtime_error("Failed to get face five key points with error code: " + std::to_string(result));
     }
 
-    // Convert to Point2f vector
+    // Convert to Point2f vector, in frame coordinates when the face was tracked on a region of interest
+    const auto [offsetX, offsetY] = roiOffset(imageStream);
     std::vector<Point2f> keyPointsVector;
     keyPointsVector.reserve(numKeyPoints);
 
     for (int i = 0; i < numKeyPoints; i++)
     {
       keyPointsVector.emplace_back(
-          static_cast<double>(keyPoints[i].x),
-          static_cast<double>(keyPoints[i].y));
+          static_cast<double>(keyPoints[i].x) + offsetX,
+          static_cast<double>(keyPoints[i].y) + offsetY);
     }
 
     return keyPointsVector;
   }
 
-  double HybridInspireFace::featureHubFaceInsert(const FaceFeatureIdentity &feature)
+  std::shared_ptr<ArrayBuffer> HybridInspireFace::getFaceDenseLandmarksFromFaceTokens(const std::vector<std::shared_ptr<ArrayBuffer>> &tokens, const std::optional<std::shared_ptr<HybridImageStreamSpec>> &imageStream)
+  {
+    return decodeTokenPoints(tokens, denseLandmarkCount(), roiOffset(imageStream), HFGetFaceDenseLandmarkFromFaceToken, "dense landmarks");
+  }
+
+  std::shared_ptr<ArrayBuffer> HybridInspireFace::getFaceFiveKeyPointsFromFaceTokens(const std::vector<std::shared_ptr<ArrayBuffer>> &tokens, const std::optional<std::shared_ptr<HybridImageStreamSpec>> &imageStream)
+  {
+    return decodeTokenPoints(tokens, 5, roiOffset(imageStream), HFGetFaceFiveKeyPointsFromFaceToken, "five key points");
+  }
+
+  double HybridInspireFace::featureHubFaceInsert(const FaceFeatureIdentity &feature, const std::optional<std::shared_ptr<HybridImageBitmapSpec>> &crop)
   {
+    auto cropImage = cropBitmap(crop);
     if (!feature.feature || feature.feature->size() == 0)
     {
       throw std::runtime_error("Invalid feature data");
@@ -342,17 +590,26 @@ namespace margelo::nitro::nitroinspireface
     identity.feature = &hfFeature;
 
     // Insert the feature
+    std::lock_guard<std::mutex> lock(FeatureGallery::shared().hubMutex());
     HFaceId allocId;
     HResult result = HFFeatureHubInsertFeature(identity, &allocId);
     if (result != HSUCCEED)
     {
       throw std::runtime_error("Failed to insert feature with error code: " + std::to_string(result));
     }
+    FeatureGallery::shared().tag(allocId);
+    FeatureGallery::shared().putFeature(allocId, hfFeature.data, hfFeature.size);
+    // The feature is stored already, a failed crop only costs the ability to migrate it
+    if (cropImage && !storeCrop(allocId, *cropImage))
+    {
+      Logger::log(LogLevel::Error, TAG, "Failed to store face crop for id %lld", static_cast<long long>(allocId));
+    }
     return allocId;
   }
 
-  bool HybridInspireFace::featureHubFaceUpdate(const FaceFeatureIdentity &feature)
+  bool HybridInspireFace::featureHubFaceUpdate(const FaceFeatureIdentity &feature, const std::optional<std::shared_ptr<HybridImageBitmapSpec>> &crop)
   {
+    auto cropImage = cropBitmap(crop);
     if (!feature.feature || feature.feature->size() == 0)
     {
       throw std::runtime_error("Invalid feature data");
@@ -383,13 +640,28 @@ namespace margelo::nitro::nitroinspireface
     identity.feature = &hfFeature;
 
     // Update the feature
+    std::lock_guard<std::mutex> lock(FeatureGallery::shared().hubMutex());
     HResult result = HFFeatureHubFaceUpdate(identity);
+    if (result == HSUCCEED)
+    {
+      FeatureGallery::shared().tag(identity.id);
+      FeatureGallery::shared().putFeature(identity.id, hfFeature.data, hfFeature.size);
+      if (cropImage && !storeCrop(identity.id, *cropImage))
+      {
+        Logger::log(LogLevel::Error, TAG, "Failed to store face crop for id %lld", static_cast<long long>(identity.id));
+      }
+    }
     return result == HSUCCEED;
   }
 
   bool HybridInspireFace::featureHubFaceRemove(double id)
   {
+    std::lock_guard<std::mutex> lock(FeatureGallery::shared().hubMutex());
     HResult result = HFFeatureHubFaceRemove(static_cast<HFaceId>(id));
+    if (result == HSUCCEED)
+    {
+      FeatureGallery::shared().erase(static_cast<int64_t>(id));
+    }
     return result == HSUCCEED;
   }
 
@@ -420,6 +692,22 @@ namespace margelo::nitro::nitroinspireface
     hfFeature.data = reinterpret_cast<float *>(feature->data());
 
     // Search for face
+    std::lock_guard<std::mutex> lock(FeatureGallery::shared().hubMutex());
+    if (FeatureGallery::shared().isFrequencyOrdered())
+    {
+      int64_t matchId = -1;
+      float matchConfidence = 0.0f;
+      std::vector<float> matchFeature;
+      if (!FeatureGallery::shared().searchEager(hfFeature.data, hfFeature.size, matchId, matchConfidence, matchFeature))
+      {
+        return std::nullopt;
+      }
+      return FaceFeatureIdentity(
+          static_cast<double>(matchId),
+          ArrayBuffer::copy(reinterpret_cast<uint8_t *>(matchFeature.data()), matchFeature.size() * sizeof(float)),
+          static_cast<double>(matchConfidence));
+    }
+
     HFloat confidence;
     HFFaceFeatureIdentity identity;
     HResult result = HFFeatureHubFaceSearch(hfFeature, &confidence, &identity);
@@ -442,6 +730,7 @@ namespace margelo::nitro::nitroinspireface
 
   std::optional<FaceFeatureIdentity> HybridInspireFace::featureHubGetFaceIdentity(double id)
   {
+    std::lock_guard<std::mutex> lock(FeatureGallery::shared().hubMutex());
     HFFaceFeatureIdentity identity = {};
     HResult result = HFFeatureHubGetFaceIdentity(static_cast<HFaceId>(id), &identity);
     if (result != HSUCCEED || !identity.feature)
@@ -504,6 +793,7 @@ namespace margelo::nitro::nitroinspireface
     hfFeature.data = reinterpret_cast<float *>(feature->data());
 
     // Search for faces
+    std::lock_guard<std::mutex> lock(FeatureGallery::shared().hubMutex());
     HFSearchTopKResults results;
     HResult result = HFFeatureHubFaceSearchTopK(hfFeature, static_cast<HInt32>(topK), &results);
 
@@ -538,13 +828,25 @@ namespace margelo::nitro::nitroinspireface
 
   double HybridInspireFace::getFaceDenseLandmarkLength()
   {
+    return static_cast<double>(denseLandmarkCount());
+  }
+
+  int32_t HybridInspireFace::denseLandmarkCount()
+  {
+    // Fixed for the loaded models, asked once instead of on every decode
+    int32_t count = cachedDenseLandmarkCount.load(std::memory_order_relaxed);
+    if (count > 0)
+    {
+      return count;
+    }
     HInt32 length = 0;
     HResult result = HFGetNumOfFaceDenseLandmark(&length);
-    if (result != HSUCCEED)
+    if (result != HSUCCEED || length <= 0)
     {
       throw std::runtime_error("Failed to get face dense landmark length with error code: " + std::to_string(result));
     }
-    return static_cast<double>(length);
+    cachedDenseLandmarkCount.store(length, std::memory_order_relaxed);
+    return length;
   }
 
   double HybridInspireFace::getFaceBasicTokenLength()
@@ -656,6 +958,123 @@ namespace margelo::nitro::nitroinspireface
     {
       throw std::runtime_error("Failed to disable feature hub with error code: " + std::to_string(result));
     }
+    FeatureGallery::shared().close();
+  }
+
+  std::string HybridInspireFace::getModelTag()
+  {
+    return FeatureGallery::shared().getModelTag();
+  }
+
+  std::optional<std::string> HybridInspireFace::featureHubGetFaceModelTag(double id)
+  {
+    return FeatureGallery::shared().getTag(static_cast<int64_t>(id));
+  }
+
+  std::vector<double> HybridInspireFace::featureHubGetStaleIds()
+  {
+    std::vector<double> idVector;
+    for (int64_t id : FeatureGallery::shared().getStaleIds())
+    {
+      idVector.push_back(static_cast<double>(id));
+    }
+    return idVector;
+  }
+
+  void HybridInspireFace::featureHubSetFaceCrop(double id, const std::shared_ptr<HybridImageBitmapSpec> &bitmap)
+  {
+    auto nitroBitmap = std::dynamic_pointer_cast<HybridImageBitmap>(bitmap);
+    if (!nitroBitmap)
+    {
+      throw std::runtime_error("Invalid bitmap");
+    }
+
+    // Held until the crop is stored, so the id can't be removed in between
+    std::lock_guard<std::mutex> lock(FeatureGallery::shared().hubMutex());
+    HFFaceFeatureIdentity identity = {};
+    if (HFFeatureHubGetFaceIdentity(static_cast<HFaceId>(id), &identity) != HSUCCEED || !identity.feature)
+    {
+      throw std::runtime_error("No face feature with id " + std::to_string(static_cast<int64_t>(id)));
+    }
+
+    if (!storeCrop(static_cast<int64_t>(id), *nitroBitmap))
+    {
+      throw std::runtime_error("Failed to store face crop for id " + std::to_string(static_cast<int64_t>(id)));
+    }
+  }
+
+  std::shared_ptr<Promise<FeatureMigrationResult>> HybridInspireFace::featureHubMigrate(double workerCount, const std::optional<std::function<void(double /* completed */, double /* total */)>> &onProgress)
+  {
+    auto progress = onProgress;
+    return Promise<FeatureMigrationResult>::async([workerCount, progress]() -> FeatureMigrationResult
+    {
+      FeatureMigrationStats stats = FeatureMigration::shared().run(
+          static_cast<int32_t>(workerCount),
+          [&progress](size_t completed, size_t total)
+          {
+            if (progress.has_value())
+            {
+              progress.value()(static_cast<double>(completed), static_cast<double>(total));
+            }
+          });
+
+      return FeatureMigrationResult(
+          static_cast<double>(stats.migrated),
+          static_cast<double>(stats.failed),
+          static_cast<double>(stats.skipped),
+          stats.cancelled,
+          stats.modelTag);
+    });
+  }
+
+  void HybridInspireFace::featureHubCancelMigration()
+  {
+    FeatureMigration::shared().cancel();
+  }
+
+  std::shared_ptr<Promise<GalleryAuditReport>> HybridInspireFace::featureHubAudit(double threshold, double workerCount, const std::optional<std::function<void(double /* completed */, double /* total */)>> &onProgress)
+  {
+    auto progress = onProgress;
+    return Promise<GalleryAuditReport>::async([threshold, workerCount, progress]() -> GalleryAuditReport
+    {
+      AuditStats stats = GalleryAudit::shared().run(
+          static_cast<float>(threshold),
+          static_cast<int32_t>(workerCount),
+          [&progress](size_t completed, size_t total)
+          {
+            if (progress.has_value())
+            {
+              progress.value()(static_cast<double>(completed), static_cast<double>(total));
+            }
+          });
+
+      std::vector<GalleryAuditPair> pairs;
+      pairs.reserve(stats.pairs.size());
+      for (const auto &pair : stats.pairs)
+      {
+        pairs.emplace_back(static_cast<double>(pair.first), static_cast<double>(pair.second), static_cast<double>(pair.similarity));
+      }
+
+      // Margins are measured against the threshold searches actually use
+      const float searchThreshold = FeatureGallery::shared().getSearchThreshold();
+      std::vector<GalleryIdentityMargin> margins;
+      margins.reserve(stats.neighbors.size());
+      for (const auto &neighbor : stats.neighbors)
+      {
+        margins.emplace_back(
+            static_cast<double>(neighbor.id),
+            static_cast<double>(neighbor.nearestId),
+            static_cast<double>(neighbor.similarity),
+            static_cast<double>(searchThreshold - neighbor.similarity));
+      }
+
+      return GalleryAuditReport(std::move(pairs), std::move(margins), stats.cancelled);
+    });
+  }
+
+  void HybridInspireFace::featureHubCancelAudit()
+  {
+    GalleryAudit::shared().cancel();
   }
 
   double HybridInspireFace::faceComparison(const std::shared_ptr<ArrayBuffer> &feature1, const std::shared_ptr<ArrayBuffer> &feature2)
@@ -9,13 +9,25 @@
 #include "SearchMode.hpp"
 #include "PrimaryKeyMode.hpp"
 #include "HybridSession.hpp"
+#include "HybridFaceClusterer.hpp"
+#include "FaceClustererConfig.hpp"
+#include "HybridVisitorCounter.hpp"
+#include "VisitorCounterConfig.hpp"
+#include "HybridTiledDetector.hpp"
+#include "TiledDetectorConfig.hpp"
 #include "HybridImageStream.hpp"
 #include "inspireface.h"
 #include "HybridAssetManagerSpec.hpp"
+#include "DecodedImage.hpp"
 #include <NitroModules/ArrayBuffer.hpp>
 #include <NitroModules/NitroLogger.hpp>
 #include "FaceFeatureIdentity.hpp"
+#include "FeatureMigrationResult.hpp"
+#include "GalleryAuditReport.hpp"
+#include <NitroModules/Promise.hpp>
+#include <functional>
 #include <string>
+#include <atomic>
 #include <memory>
 #include <vector>
 #include <optional>
@@ -37,6 +49,9 @@ namespace margelo::nitro::nitroinspireface
 
   private:
     std::shared_ptr<HybridAssetManagerSpec> assetManager;
+    // Number of dense landmarks of the loaded models, 0 until asked for
+    std::atomic<int32_t> cachedDenseLandmarkCount{0};
+    int32_t denseLandmarkCount();
     std::string base64_encode(const unsigned char *data, size_t len);
     std::vector<unsigned char> base64_decode(const std::string &encoded);
 
@@ -45,6 +60,7 @@ namespace margelo::nitro::nitroinspireface
     double getFeatureLength() override;
     double getFaceDenseLandmarkLength() override;
     double getFaceBasicTokenLength() override;
+    std::string getModelTag() override;
     void launch(const std::string &path) override;
     void reload(const std::string &path) override;
     void terminate() override;
@@ -57,17 +73,31 @@ namespace margelo::nitro::nitroinspireface
         double maxDetectFaceNum,
         double detectPixelLevel,
         double trackByDetectModeFPS) override;
+    std::shared_ptr<HybridFaceClustererSpec> createFaceClusterer(const FaceClustererConfig &config) override;
+    std::shared_ptr<HybridVisitorCounterSpec> createVisitorCounter(const VisitorCounterConfig &config) override;
+    std::shared_ptr<HybridTiledDetectorSpec> createTiledDetector(const TiledDetectorConfig &config) override;
     std::shared_ptr<HybridImageBitmapSpec> createImageBitmapFromFilePath(double channels, const std::string &filePath) override;
-    std::shared_ptr<HybridImageBitmapSpec> createImageBitmapFromBuffer(const std::shared_ptr<ArrayBuffer> &buffer, double width, double height, double channels) override;
+    std::shared_ptr<HybridImageBitmapSpec> createImageBitmapFromEncoded(const std::shared_ptr<ArrayBuffer> &buffer, double channels, std::optional<double> maxSize) override;
+    std::shared_ptr<Promise<std::shared_ptr<HybridImageBitmapSpec>>> createImageBitmapFromEncodedAsync(const std::shared_ptr<ArrayBuffer> &buffer, double channels, std::optional<double> maxSize) override;
+    std::shared_ptr<HybridImageBitmapSpec> createImageBitmapFromBuffer(const std::shared_ptr<ArrayBuffer> &buffer, double width, double height, double channels, std::optional<bool> adopt) override;
     std::shared_ptr<HybridImageStreamSpec> createImageStreamFromBitmap(const std::shared_ptr<HybridImageBitmapSpec> &bitmap, CameraRotation rotation) override;
-    std::vector<Point2f> getFaceDenseLandmarkFromFaceToken(const std::shared_ptr<ArrayBuffer> &token, std::optional<double> num = std::nullopt) override;
-    std::vector<Point2f> getFaceFiveKeyPointsFromFaceToken(const std::shared_ptr<ArrayBuffer> &token, std::optional<double> num = std::nullopt) override;
-    double featureHubFaceInsert(const FaceFeatureIdentity &feature) override;
-    bool featureHubFaceUpdate(const FaceFeatureIdentity &feature) override;
+    std::vector<Point2f> getFaceDenseLandmarkFromFaceToken(const std::shared_ptr<ArrayBuffer> &token, std::optional<double> num = std::nullopt, const std::optional<std::shared_ptr<HybridImageStreamSpec>> &imageStream = std::nullopt) override;
+    std::vector<Point2f> getFaceFiveKeyPointsFromFaceToken(const std::shared_ptr<ArrayBuffer> &token, std::optional<double> num = std::nullopt, const std::optional<std::shared_ptr<HybridImageStreamSpec>> &imageStream = std::nullopt) override;
+    std::shared_ptr<ArrayBuffer> getFaceDenseLandmarksFromFaceTokens(const std::vector<std::shared_ptr<ArrayBuffer>> &tokens, const std::optional<std::shared_ptr<HybridImageStreamSpec>> &imageStream) override;
+    std::shared_ptr<ArrayBuffer> getFaceFiveKeyPointsFromFaceTokens(const std::vector<std::shared_ptr<ArrayBuffer>> &tokens, const std::optional<std::shared_ptr<HybridImageStreamSpec>> &imageStream) override;
+    double featureHubFaceInsert(const FaceFeatureIdentity &feature, const std::optional<std::shared_ptr<HybridImageBitmapSpec>> &crop) override;
+    bool featureHubFaceUpdate(const FaceFeatureIdentity &feature, const std::optional<std::shared_ptr<HybridImageBitmapSpec>> &crop) override;
     bool featureHubFaceRemove(double id) override;
     std::optional<FaceFeatureIdentity> featureHubFaceSearch(const std::shared_ptr<ArrayBuffer> &feature) override;
     std::optional<FaceFeatureIdentity> featureHubGetFaceIdentity(double id) override;
     std::vector<SearchTopKResult> featureHubFaceSearchTopK(const std::shared_ptr<ArrayBuffer> &feature, double topK) override;
+    std::optional<std::string> featureHubGetFaceModelTag(double id) override;
+    std::vector<double> featureHubGetStaleIds() override;
+    void featureHubSetFaceCrop(double id, const std::shared_ptr<HybridImageBitmapSpec> &bitmap) override;
+    std::shared_ptr<Promise<FeatureMigrationResult>> featureHubMigrate(double workerCount, const std::optional<std::function<void(double /* completed */, double /* total */)>> &onProgress) override;
+    void featureHubCancelMigration() override;
+    std::shared_ptr<Promise<GalleryAuditReport>> featureHubAudit(double threshold, double workerCount, const std::optional<std::function<void(double /* completed */, double /* total */)>> &onProgress) override;
+    void featureHubCancelAudit() override;
     double featureHubGetFaceCount() override;
     std::vector<double> featureHubGetExistingIds() override;
     double faceComparison(const std::shared_ptr<ArrayBuffer> &feature1, const std::shared_ptr<ArrayBuffer> &feature2) override;
@@ -11,17 +11,98 @@
 #include "FaceInteractionsAction.hpp"
 #include "FaceAttributeResult.hpp"
 #include "HybridImageStream.hpp"
+#include "FeatureGallery.hpp"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <iterator>
+#include <mutex>
+#include <unordered_set>
 #include <memory>
 #include <vector>
 
 namespace margelo::nitro::nitroinspireface
 {
+  namespace
+  {
+    // 1 for a frontal face, 0 once yaw and pitch add up to 90 degrees
+    float poseScore(const HFMultipleFaceData &faces, int index)
+    {
+      const float poseError = std::abs(faces.angles.yaw[index]) + std::abs(faces.angles.pitch[index]);
+      return std::max(0.0f, 1.0f - poseError / 90.0f);
+    }
+
+    // HF_ENABLE_* flag of an optional pipeline stage
+    HInt32 stageOption(PipelineScheduler::Stage stage)
+    {
+      switch (stage)
+      {
+      case PipelineScheduler::Quality:
+        return HF_ENABLE_QUALITY;
+      case PipelineScheduler::Liveness:
+        return HF_ENABLE_LIVENESS;
+      case PipelineScheduler::Mask:
+        return HF_ENABLE_MASK_DETECT;
+      case PipelineScheduler::Attribute:
+        return HF_ENABLE_FACE_ATTRIBUTE;
+      default:
+        return HF_ENABLE_NONE;
+      }
+    }
+
+    // Owns the arrays behind a HFMultipleFaceData built from FaceData
+    struct NativeFaces
+    {
+      std::vector<HFaceRect> rects;
+      std::vector<HInt32> trackIds;
+      std::vector<HFloat> detConfidence;
+      std::vector<HFloat> roll;
+      std::vector<HFloat> yaw;
+      std::vector<HFloat> pitch;
+      std::vector<HFFaceBasicToken> tokens;
+
+      // Rects are moved from frame coordinates into the region of interest of the stream
+      void add(const FaceData &face, int32_t trackId, const HybridImageStream &stream)
+      {
+        rects.push_back({static_cast<HInt32>(face.rect.x) - stream.getRoiX(), static_cast<HInt32>(face.rect.y) - stream.getRoiY(),
+                         static_cast<HInt32>(face.rect.width), static_cast<HInt32>(face.rect.height)});
+        trackIds.push_back(static_cast<HInt32>(trackId));
+        detConfidence.push_back(static_cast<HFloat>(face.detConfidence));
+        roll.push_back(static_cast<HFloat>(face.angle.roll));
+        yaw.push_back(static_cast<HFloat>(face.angle.yaw));
+        pitch.push_back(static_cast<HFloat>(face.angle.pitch));
+        HFFaceBasicToken token = {};
+        token.size = static_cast<HInt32>(face.token->size());
+        token.data = face.token->data();
+        tokens.push_back(token);
+      }
+
+      HFMultipleFaceData view()
+      {
+        HFMultipleFaceData faces = {};
+        faces.detectedNum = static_cast<HInt32>(rects.size());
+        faces.rects = rects.data();
+        faces.trackIds = trackIds.data();
+        faces.detConfidence = detConfidence.data();
+        faces.angles.roll = roll.data();
+        faces.angles.yaw = yaw.data();
+        faces.angles.pitch = pitch.data();
+        faces.tokens = tokens.data();
+        return faces;
+      }
+    };
+  } // namespace
+
   HybridSession::HybridSession() : HybridObject(TAG), _session(nullptr) {}
 
   HybridSession::HybridSession(HFSession session) : HybridObject(TAG), _session(session) {}
 
   void HybridSession::cleanup()
   {
+    _onBestShots.reset();
+    _bestShots.clear();
+    _cascadeDetector.release();
     if (_session != nullptr)
     {
       HFReleaseInspireFaceSession(_session);
@@ -46,6 +127,15 @@ namespace margelo::nitro::nitroinspireface
       throw std::runtime_error("HybridSession is not initialized");
     }
 
+    _trackSettings.previewSize = static_cast<int32_t>(size);
+    if (_adaptiveEnabled)
+    {
+      // The controller continues from the new value, within its bounds
+      _adaptiveController.reset(_trackSettings);
+      applyTrackSettings(_adaptiveController.settings());
+      return;
+    }
+
     HResult result = HFSessionSetTrackPreviewSize(_session, static_cast<HInt32>(size));
     if (result != HSUCCEED)
     {
@@ -102,37 +192,788 @@ namespace margelo::nitro::nitroinspireface
       throw std::runtime_error("HybridSession is not initialized");
     }
 
-    HResult result = HFSessionSetTrackModeNumSmoothCacheFrame(_session, static_cast<HInt32>(num));
-    if (result != HSUCCEED)
+    HResult result = HFSessionSetTrackModeNumSmoothCacheFrame(_session, static_cast<HInt32>(num));
+    if (result != HSUCCEED)
+    {
+      throw std::runtime_error("Failed to set track mode num smooth cache frame with error code: " + std::to_string(result));
+    }
+  }
+
+  void HybridSession::setTrackModeDetectInterval(double num)
+  {
+    if (_session == nullptr)
+    {
+      throw std::runtime_error("HybridSession is not initialized");
+    }
+
+    _trackSettings.detectInterval = static_cast<int32_t>(num);
+    if (_adaptiveEnabled)
+    {
+      _adaptiveController.reset(_trackSettings);
+      applyTrackSettings(_adaptiveController.settings());
+      return;
+    }
+
+    HResult result = HFSessionSetTrackModeDetectInterval(_session, static_cast<HInt32>(num));
+    if (result != HSUCCEED)
+    {
+      throw std::runtime_error("Failed to set track mode detect interval with error code: " + std::to_string(result));
+    }
+  }
+
+  std::vector<FaceData> HybridSession::executeFaceTrack(const std::shared_ptr<HybridImageStreamSpec> &imageStream)
+  {
+    if (!_session)
+    {
+      throw std::runtime_error("HybridSession is null");
+    }
+    if (!imageStream)
+    {
+      throw std::runtime_error("Image stream is null");
+    }
+
+    auto nitroImageStream = std::dynamic_pointer_cast<HybridImageStream>(imageStream);
+    if (!nitroImageStream)
+    {
+      throw std::runtime_error("Invalid image stream type");
+    }
+
+    // Nothing moved since the last tracked frame, its faces are still valid
+    if (_motionGateEnabled && isStaticFrame(*nitroImageStream))
+    {
+      _lastTrackTime = 0.0;
+      return _lastFaces;
+    }
+
+    HFMultipleFaceData results{};
+    trackFaces(*nitroImageStream, results);
+
+    Logger::log(LogLevel::Info, TAG, "Face track results: %d", results.detectedNum);
+
+    // Process results into a vector
+    std::vector<FaceData> faceDataVector;
+    if (results.detectedNum > 0)
+    {
+      faceDataVector.reserve(results.detectedNum);
+
+      for (int i = 0; i < results.detectedNum; ++i)
+      {
+        // Construct FaceRect
+        FaceRect rect(
+            static_cast<double>(results.rects[i].x + _roiX),
+            static_cast<double>(results.rects[i].y + _roiY),
+            static_cast<double>(results.rects[i].width),
+            static_cast<double>(results.rects[i].height));
+
+        // Extract track ID and confidence
+        double trackId = static_cast<double>(reportedTrackId(results.trackIds[i]));
+        double detConfidence = static_cast<double>(results.detConfidence[i]);
+
+        // Construct FaceEulerAngle
+        FaceEulerAngle angles(
+            static_cast<double>(results.angles.roll[i]),
+            static_cast<double>(results.angles.yaw[i]),
+            static_cast<double>(results.angles.pitch[i]));
+
+        // Handle token data
+        std::shared_ptr<margelo::nitro::ArrayBuffer> buffer;
+        if (results.tokens[i].size > 0 && results.tokens[i].data != nullptr)
+        {
+          try
+          {
+            buffer = margelo::nitro::ArrayBuffer::copy(
+                static_cast<uint8_t *>(results.tokens[i].data),
+                results.tokens[i].size);
+          }
+          catch (const std::bad_alloc &e)
+          {
+            buffer = margelo::nitro::ArrayBuffer::allocate(0); // Fallback to empty buffer
+          }
+        }
+        else
+        {
+          buffer = margelo::nitro::ArrayBuffer::allocate(0); // Empty buffer if no valid token
+        }
+
+        // Add FaceData to vector
+        faceDataVector.emplace_back(rect, trackId, detConfidence, angles, buffer);
+      }
+    }
+
+    if (_motionGateEnabled)
+    {
+      _lastFaces = faceDataVector;
+    }
+    return faceDataVector;
+  }
+
+  bool HybridSession::isStaticFrame(const HybridImageStream &stream)
+  {
+    const HFImageBitmapData *data = stream.getSourceData();
+    if (data == nullptr)
+    {
+      return false;
+    }
+
+    // Faces and the gate reference of another region say nothing about this one
+    const FaceRect roi(stream.getRoiX(), stream.getRoiY(), stream.getRoiWidth(), stream.getRoiHeight());
+    if (roi.x != _lastFacesRoi.x || roi.y != _lastFacesRoi.y || roi.width != _lastFacesRoi.width || roi.height != _lastFacesRoi.height)
+    {
+      _motionGate.reset();
+      _lastFaces.clear();
+      _lastFacesRoi = roi;
+    }
+    if (roi.width <= 0)
+    {
+      return _motionGate.update(data->data, data->width, data->height, data->channels);
+    }
+
+    // Only the region is tracked, so only motion inside it counts
+    const size_t stride = static_cast<size_t>(data->width) * data->channels;
+    const uint8_t *origin = data->data + static_cast<size_t>(_lastFacesRoi.y) * stride + static_cast<size_t>(_lastFacesRoi.x) * data->channels;
+    return _motionGate.update(origin, static_cast<int32_t>(roi.width), static_cast<int32_t>(roi.height), data->channels, stride);
+  }
+
+  void HybridSession::setMotionGateConfig(const MotionGateConfig &config)
+  {
+    _motionGateEnabled = config.enabled;
+    _motionGate.configure(
+        static_cast<float>(config.threshold.value_or(0.01)),
+        static_cast<uint32_t>(std::max(0.0, config.maxSkippedFrames.value_or(30.0))));
+    _lastFaces.clear();
+    _lastFacesRoi = FaceRect(0, 0, 0, 0);
+  }
+
+  double HybridSession::getMotionScore()
+  {
+    return static_cast<double>(_motionGate.score());
+  }
+
+  void HybridSession::setCoarseToFineConfig(const CoarseToFineConfig &config)
+  {
+    if (!config.enabled)
+    {
+      _cascadeDetector.release();
+      return;
+    }
+    _cascadeDetector.configure(
+        static_cast<int32_t>(config.coarseSize.value_or(320)),
+        static_cast<int32_t>(config.detectPixelLevel.value_or(160)),
+        static_cast<int32_t>(config.maxDetectFaceNum.value_or(20)),
+        static_cast<float>(config.margin.value_or(0.5)),
+        static_cast<float>(config.iouThreshold.value_or(0.4)));
+  }
+
+  CoarseToFineResult HybridSession::detectCoarseToFine(const std::shared_ptr<HybridImageStreamSpec> &imageStream)
+  {
+    auto nitroImageStream = std::dynamic_pointer_cast<HybridImageStream>(imageStream);
+    if (!nitroImageStream)
+    {
+      throw std::runtime_error("Failed to cast to HybridImageStream");
+    }
+    std::vector<uint8_t> uprightPixels;
+    HFImageBitmapData upright{};
+    const HFImageBitmapData *source = nitroImageStream->getUprightData(uprightPixels, upright);
+    if (source == nullptr)
+    {
+      throw std::runtime_error("Image stream was not created from a bitmap");
+    }
+    const HFImageBitmapData &frame = *source;
+    if (frame.channels != 3)
+    {
+      throw std::runtime_error("Coarse-to-fine detection needs a 3 channel bitmap, got " + std::to_string(frame.channels));
+    }
+
+    std::vector<Detection> detections = _cascadeDetector.detect(frame.data, frame.width, frame.height);
+    std::vector<DetectedFace> faces;
+    faces.reserve(detections.size());
+    for (const auto &face : detections)
+    {
+      faces.emplace_back(
+          FaceRect(face.x, face.y, face.width, face.height),
+          static_cast<double>(face.confidence),
+          FaceEulerAngle(face.roll, face.yaw, face.pitch));
+    }
+    return CoarseToFineResult(
+        std::move(faces),
+        static_cast<double>(_cascadeDetector.candidateCount()),
+        _cascadeDetector.coarseTime(),
+        _cascadeDetector.fineTime());
+  }
+
+  void HybridSession::trackFaces(const HybridImageStream &imageStream, HFMultipleFaceData &faces)
+  {
+    HFImageStream stream = imageStream.getNativeHandle();
+    _roiX = imageStream.getRoiX();
+    _roiY = imageStream.getRoiY();
+
+    const auto start = std::chrono::steady_clock::now();
+    HResult status = HFExecuteFaceTrack(_session, stream, &faces);
+    if (status != HSUCCEED)
+    {
+      throw std::runtime_error("Face track failed with code: " + std::to_string(status));
+    }
+    // The controller only judges the tracker, the knobs it turns don't affect the work in updateTracks
+    const double trackTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    // Tracks that started or ended on this frame, before updateTracks replaces the active set
+    int32_t continued = 0;
+    for (int i = 0; i < faces.detectedNum; i++)
+    {
+      continued += _activeTracks.count(faces.trackIds[i]) ? 1 : 0;
+    }
+    const int32_t churn = (faces.detectedNum - continued) + (static_cast<int32_t>(_activeTracks.size()) - continued);
+
+    updateTracks(stream, faces);
+
+    _lastTrackTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    if (_adaptiveEnabled)
+    {
+      if (_adaptiveController.record(trackTime, faces.detectedNum, churn))
+      {
+        applyTrackSettings(_adaptiveController.settings());
+      }
+    }
+  }
+
+  void HybridSession::applyTrackSettings(const AdaptiveTrackController::Settings &settings)
+  {
+    HResult result = HFSessionSetTrackModeDetectInterval(_session, settings.detectInterval);
+    if (result != HSUCCEED)
+    {
+      Logger::log(LogLevel::Error, TAG, "Failed to set track mode detect interval, error code: %ld", result);
+    }
+    result = HFSessionSetTrackPreviewSize(_session, settings.previewSize);
+    if (result != HSUCCEED)
+    {
+      Logger::log(LogLevel::Error, TAG, "Failed to set track preview size, error code: %ld", result);
+    }
+  }
+
+  void HybridSession::setAdaptiveTrackingConfig(const AdaptiveTrackingConfig &config)
+  {
+    if (_session == nullptr)
+    {
+      throw std::runtime_error("HybridSession is not initialized");
+    }
+
+    const bool wasEnabled = _adaptiveEnabled;
+    _adaptiveEnabled = config.enabled;
+    // Start from the caller's settings, so enabling only changes what falls outside the bounds
+    _adaptiveController.configure(
+        config.targetFrameTime,
+        static_cast<int32_t>(config.minDetectInterval.value_or(5)),
+        static_cast<int32_t>(config.maxDetectInterval.value_or(60)),
+        static_cast<int32_t>(config.minPreviewSize.value_or(128)),
+        static_cast<int32_t>(config.maxPreviewSize.value_or(320)),
+        _trackSettings);
+    const auto settings = _adaptiveController.settings();
+    if (_adaptiveEnabled)
+    {
+      if (wasEnabled || settings.detectInterval != _trackSettings.detectInterval || settings.previewSize != _trackSettings.previewSize)
+      {
+        applyTrackSettings(settings);
+      }
+    }
+    else if (wasEnabled)
+    {
+      // Hand the caller's settings back
+      applyTrackSettings(_trackSettings);
+    }
+  }
+
+  AdaptiveTrackingState HybridSession::getAdaptiveTrackingState()
+  {
+    const auto settings = _adaptiveController.settings();
+    return AdaptiveTrackingState(
+        _adaptiveEnabled,
+        _adaptiveController.averageFrameTime(),
+        _adaptiveController.averageFaceCount(),
+        _adaptiveController.averageChurn(),
+        static_cast<double>(settings.detectInterval),
+        static_cast<double>(settings.previewSize));
+  }
+
+  void HybridSession::setFrameBudget(double budget)
+  {
+    _pipelineScheduler.configure(budget);
+  }
+
+  ScheduledPipelineResult HybridSession::scheduledPipelineProcess(const std::shared_ptr<HybridImageStreamSpec> &imageStream, const std::vector<FaceData> &multipleFaceData, const SessionCustomParameter &parameter)
+  {
+    if (_session == nullptr)
+    {
+      throw std::runtime_error("HybridSession is not initialized");
+    }
+
+    auto nitroImageStream = std::dynamic_pointer_cast<HybridImageStream>(imageStream);
+    if (!nitroImageStream)
+    {
+      throw std::runtime_error("Failed to cast to HybridImageStream");
+    }
+    for (const auto &face : multipleFaceData)
+    {
+      if (!face.token)
+      {
+        throw std::runtime_error("Invalid face data");
+      }
+    }
+
+    HFImageStream stream = nitroImageStream->getNativeHandle();
+    std::vector<int32_t> trackIds;
+    std::vector<PipelineFaceResult> results;
+    trackIds.reserve(multipleFaceData.size());
+    results.reserve(multipleFaceData.size());
+    for (const auto &face : multipleFaceData)
+    {
+      trackIds.push_back(nativeTrackId(static_cast<int32_t>(face.trackId)));
+      results.emplace_back(face.trackId, std::nullopt, std::nullopt, std::nullopt, std::nullopt, std::nullopt);
+    }
+
+    std::array<bool, PipelineScheduler::StageCount> enabled{};
+    enabled[PipelineScheduler::Recognition] = parameter.enableRecognition.value_or(false);
+    enabled[PipelineScheduler::Quality] = parameter.enableFaceQuality.value_or(false);
+    enabled[PipelineScheduler::Liveness] = parameter.enableLiveness.value_or(false);
+    enabled[PipelineScheduler::Mask] = parameter.enableMaskDetect.value_or(false);
+    enabled[PipelineScheduler::Attribute] = parameter.enableFaceAttribute.value_or(false);
+
+    // Staleness ages every frame, also when a stage throws
+    struct FrameGuard
+    {
+      PipelineScheduler &scheduler;
+      const std::vector<int32_t> &trackIds;
+      ~FrameGuard() { scheduler.endFrame(trackIds); }
+    } frameGuard{_pipelineScheduler, trackIds};
+
+    // Tracking already spent part of the budget on this frame
+    const bool unlimited = _pipelineScheduler.budget() <= 0.0;
+    double spent = 0.0;
+    std::vector<PipelineStage> stages;
+    for (auto stage : _pipelineScheduler.stageOrder(enabled))
+    {
+      const double remaining = unlimited ? 0.0 : _pipelineScheduler.budget() - _lastTrackTime - spent;
+      const std::vector<size_t> picks = _pipelineScheduler.pickFaces(stage, trackIds, remaining);
+      if (picks.empty())
+      {
+        continue;
+      }
+
+      std::vector<int32_t> ran;
+      ran.reserve(picks.size());
+      const auto start = std::chrono::steady_clock::now();
+      if (stage == PipelineScheduler::Recognition)
+      {
+        for (size_t index : picks)
+        {
+          // A face that fails stays stale and is picked first on the next frame
+          try
+          {
+            std::vector<float> feature = extractCachedFeature(stream, multipleFaceData[index]);
+            results[index].feature = ArrayBuffer::copy(reinterpret_cast<uint8_t *>(feature.data()), feature.size() * sizeof(float));
+            ran.push_back(trackIds[index]);
+          }
+          catch (const std::exception &e)
+          {
+            Logger::log(LogLevel::Error, TAG, "Failed to extract feature of track %d: %s", trackIds[index], e.what());
+          }
+        }
+      }
+      else
+      {
+        runPipelineStages(*nitroImageStream, stageOption(stage), multipleFaceData, picks, results);
+        for (size_t index : picks)
+        {
+          ran.push_back(trackIds[index]);
+        }
+      }
+      const double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+      spent += elapsed;
+
+      _pipelineScheduler.record(stage, ran, elapsed);
+      if (!ran.empty())
+      {
+        stages.push_back(static_cast<PipelineStage>(stage));
+      }
+    }
+
+    return ScheduledPipelineResult(std::move(stages), std::move(results), _lastTrackTime + spent);
+  }
+
+  void HybridSession::runPipelineStages(const HybridImageStream &stream, HInt32 options, const std::vector<FaceData> &faces, const std::vector<size_t> &picks, std::vector<PipelineFaceResult> &results)
+  {
+    NativeFaces nativeFaces;
+    for (size_t index : picks)
+    {
+      nativeFaces.add(faces[index], nativeTrackId(static_cast<int32_t>(faces[index].trackId)), stream);
+    }
+    HFMultipleFaceData subset = nativeFaces.view();
+
+    HResult result = HFMultipleFacePipelineProcessOptional(_session, stream.getNativeHandle(), &subset, options);
+    if (result != HSUCCEED)
+    {
+      throw std::runtime_error("Pipeline process failed with code: " + std::to_string(result));
+    }
+
+    // Every call overwrites the previous results, read them before the next call
+    if (options & HF_ENABLE_QUALITY)
+    {
+      HFFaceQualityConfidence confidence = {};
+      result = HFGetFaceQualityConfidence(_session, &confidence);
+      for (size_t i = 0; result == HSUCCEED && i < picks.size() && i < static_cast<size_t>(confidence.num); i++)
+      {
+        results[picks[i]].quality = static_cast<double>(confidence.confidence[i]);
+      }
+    }
+    if (options & HF_ENABLE_LIVENESS)
+    {
+      HFRGBLivenessConfidence confidence = {};
+      result = HFGetRGBLivenessConfidence(_session, &confidence);
+      for (size_t i = 0; result == HSUCCEED && i < picks.size() && i < static_cast<size_t>(confidence.num); i++)
+      {
+        results[picks[i]].liveness = static_cast<double>(confidence.confidence[i]);
+      }
+    }
+    if (options & HF_ENABLE_MASK_DETECT)
+    {
+      HFFaceMaskConfidence confidence = {};
+      result = HFGetFaceMaskConfidence(_session, &confidence);
+      for (size_t i = 0; result == HSUCCEED && i < picks.size() && i < static_cast<size_t>(confidence.num); i++)
+      {
+        results[picks[i]].mask = static_cast<double>(confidence.confidence[i]);
+      }
+    }
+    if (options & HF_ENABLE_FACE_ATTRIBUTE)
+    {
+      HFFaceAttributeResult attributes = {};
+      result = HFGetFaceAttributeResult(_session, &attributes);
+      for (size_t i = 0; result == HSUCCEED && i < picks.size() && i < static_cast<size_t>(attributes.num); i++)
+      {
+        results[picks[i]].attribute = FaceAttributeResult(
+            static_cast<double>(attributes.ageBracket[i]),
+            static_cast<double>(attributes.gender[i]),
+            static_cast<double>(attributes.race[i]));
+      }
+    }
+  }
+
+  void HybridSession::setAttributeCacheConfig(const AttributeCacheConfig &config)
+  {
+    _attributeCache.configure(config.ttl.value_or(5000.0));
+  }
+
+  std::vector<PipelineFaceResult> HybridSession::multipleFacePipelineProcessCached(const std::shared_ptr<HybridImageStreamSpec> &imageStream, const std::vector<FaceData> &multipleFaceData, const SessionCustomParameter &parameter)
+  {
+    if (_session == nullptr)
+    {
+      throw std::runtime_error("HybridSession is not initialized");
+    }
+
+    auto nitroImageStream = std::dynamic_pointer_cast<HybridImageStream>(imageStream);
+    if (!nitroImageStream)
+    {
+      throw std::runtime_error("Failed to cast to HybridImageStream");
+    }
+    for (const auto &face : multipleFaceData)
+    {
+      if (!face.token)
+      {
+        throw std::runtime_error("Invalid face data");
+      }
+    }
+
+    HInt32 options = HF_ENABLE_NONE;
+    options |= parameter.enableFaceQuality.value_or(false) ? HF_ENABLE_QUALITY : HF_ENABLE_NONE;
+    options |= parameter.enableLiveness.value_or(false) ? HF_ENABLE_LIVENESS : HF_ENABLE_NONE;
+    options |= parameter.enableMaskDetect.value_or(false) ? HF_ENABLE_MASK_DETECT : HF_ENABLE_NONE;
+    options |= parameter.enableFaceAttribute.value_or(false) ? HF_ENABLE_FACE_ATTRIBUTE : HF_ENABLE_NONE;
+
+    HFImageStream stream = nitroImageStream->getNativeHandle();
+    const auto now = TrackAttributeCache::Clock::now();
+    std::vector<PipelineFaceResult> results;
+    std::vector<size_t> refresh;
+    results.reserve(multipleFaceData.size());
+    for (size_t i = 0; i < multipleFaceData.size(); i++)
+    {
+      const FaceData &face = multipleFaceData[i];
+      results.emplace_back(face.trackId, std::nullopt, std::nullopt, std::nullopt, std::nullopt, std::nullopt);
+      if (options == HF_ENABLE_NONE)
+      {
+        continue;
+      }
+
+      const auto *entry = _attributeCache.lookup(nativeTrackId(static_cast<int32_t>(face.trackId)), options, now);
+      if (entry == nullptr)
+      {
+        refresh.push_back(i);
+        continue;
+      }
+      PipelineFaceResult &cached = results.back();
+      cached.quality = (options & HF_ENABLE_QUALITY) ? std::optional<double>(entry->quality) : std::nullopt;
+      cached.liveness = (options & HF_ENABLE_LIVENESS) ? std::optional<double>(entry->liveness) : std::nullopt;
+      cached.mask = (options & HF_ENABLE_MASK_DETECT) ? std::optional<double>(entry->mask) : std::nullopt;
+      if (options & HF_ENABLE_FACE_ATTRIBUTE)
+      {
+        cached.attribute = FaceAttributeResult(
+            static_cast<double>(entry->ageBracket),
+            static_cast<double>(entry->gender),
+            static_cast<double>(entry->race));
+      }
+    }
+
+    // Only new tracks and stale entries go through the pipeline, in a single call
+    if (!refresh.empty())
+    {
+      runPipelineStages(*nitroImageStream, options, multipleFaceData, refresh, results);
+      for (size_t index : refresh)
+      {
+        // Only stages whose result was actually read are cached, a failed getter is retried on the next call
+        const PipelineFaceResult &fresh = results[index];
+        HInt32 read = HF_ENABLE_NONE;
+        read |= fresh.quality.has_value() ? HF_ENABLE_QUALITY : HF_ENABLE_NONE;
+        read |= fresh.liveness.has_value() ? HF_ENABLE_LIVENESS : HF_ENABLE_NONE;
+        read |= fresh.mask.has_value() ? HF_ENABLE_MASK_DETECT : HF_ENABLE_NONE;
+        read |= fresh.attribute.has_value() ? HF_ENABLE_FACE_ATTRIBUTE : HF_ENABLE_NONE;
+        if (read == HF_ENABLE_NONE)
+        {
+          continue;
+        }
+
+        auto &entry = _attributeCache.store(nativeTrackId(static_cast<int32_t>(fresh.trackId)), read, now);
+        entry.quality = static_cast<float>(fresh.quality.value_or(0.0));
+        entry.liveness = static_cast<float>(fresh.liveness.value_or(0.0));
+        entry.mask = static_cast<float>(fresh.mask.value_or(0.0));
+        if (fresh.attribute.has_value())
+        {
+          entry.ageBracket = static_cast<int32_t>(fresh.attribute->ageBracket);
+          entry.gender = static_cast<int32_t>(fresh.attribute->gender);
+          entry.race = static_cast<int32_t>(fresh.attribute->race);
+        }
+      }
+    }
+
+    if (parameter.enableRecognition.value_or(false))
+    {
+      for (size_t i = 0; i < multipleFaceData.size(); i++)
+      {
+        std::vector<float> feature = extractCachedFeature(stream, multipleFaceData[i]);
+        results[i].feature = ArrayBuffer::copy(reinterpret_cast<uint8_t *>(feature.data()), feature.size() * sizeof(float));
+      }
+    }
+    return results;
+  }
+
+  void HybridSession::clearAttributeCache()
+  {
+    _attributeCache.clear();
+  }
+
+  void HybridSession::updateTracks(HFImageStream stream, const HFMultipleFaceData &faces)
+  {
+    std::vector<int32_t> trackIds(faces.trackIds, faces.trackIds + faces.detectedNum);
+    _freshFeatures.clear();
+    if (_reidEnabled)
+    {
+      reidentifyTracks(stream, faces, trackIds);
+    }
+
+    // Fused features of ended tracks stay readable under the trackId they were reported with
+    std::unordered_set<int32_t> alive(trackIds.begin(), trackIds.end());
+    for (int32_t trackId : _activeTracks)
+    {
+      if (_aliases.count(trackId) && !alive.count(trackId))
+      {
+        _featureFusion.rename(trackId, reportedTrackId(trackId));
+      }
+    }
+
+    // Forget the per-track state of tracks that ended
+    _featureCache.retain(trackIds);
+    _attributeCache.retain(trackIds);
+    _featureFusion.retain(trackIds, TrackFeatureFusion::Clock::now());
+    retainIdentities(trackIds);
+    if (_fusionEnabled)
+    {
+      fuseTrackFeatures(stream, faces);
+    }
+    else if (_reidEnabled)
+    {
+      sampleReidFeatures(stream, faces);
+    }
+    if (_onBestShots.has_value())
+    {
+      collectBestShots(stream, faces, trackIds);
+    }
+
+    // Aliases go last, ended tracks above are still reported under their continued trackId
+    for (auto it = _aliases.begin(); it != _aliases.end();)
+    {
+      if (alive.count(it->first))
+      {
+        it = std::next(it);
+        continue;
+      }
+      // The reported trackId may already continue in a track that started on this frame
+      auto native = _nativeTrackIds.find(it->second);
+      if (native != _nativeTrackIds.end() && native->second == it->first)
+      {
+        _nativeTrackIds.erase(native);
+      }
+      it = _aliases.erase(it);
+    }
+    _activeTracks = std::move(alive);
+  }
+
+  void HybridSession::sampleReidFeatures(HFImageStream stream, const HFMultipleFaceData &faces)
+  {
+    // Without fusion nothing else may extract a feature before a track ends, so every track gets one
+    for (int i = 0; i < faces.detectedNum; i++)
+    {
+      const int32_t trackId = faces.trackIds[i];
+      auto identity = _identities.find(trackId);
+      if ((identity != _identities.end() && !identity->second.feature.empty()) || _featureCache.peek(trackId) != nullptr)
+      {
+        continue;
+      }
+      try
+      {
+        bool extracted = false;
+        extractCachedFeature(stream, trackId, faces.tokens[i], static_cast<float>(faces.rects[i].width * faces.rects[i].height),
+                             std::abs(faces.angles.yaw[i]) + std::abs(faces.angles.pitch[i]), extracted);
+      }
+      catch (const std::exception &e)
+      {
+        Logger::log(LogLevel::Error, TAG, "Failed to extract feature of track %d: %s", trackId, e.what());
+      }
+    }
+  }
+
+  void HybridSession::reidentifyTracks(HFImageStream stream, const HFMultipleFaceData &faces, const std::vector<int32_t> &trackIds)
+  {
+    const auto now = ReidBuffer::Clock::now();
+    const std::unordered_set<int32_t> alive(trackIds.begin(), trackIds.end());
+
+    // Remember the tracks that ended on this frame with the best feature known for them
+    std::vector<float> feature;
+    for (int32_t trackId : _activeTracks)
+    {
+      if (alive.count(trackId))
+      {
+        continue;
+      }
+
+      auto identity = _identities.find(trackId);
+      if (!_featureFusion.get(trackId, feature))
+      {
+        const std::vector<float> *cached = _featureCache.peek(trackId);
+        if (identity != _identities.end() && !identity->second.feature.empty())
+        {
+          feature = identity->second.feature;
+        }
+        else if (cached != nullptr)
+        {
+          feature = *cached;
+        }
+        else
+        {
+          continue;
+        }
+      }
+
+      const bool known = identity != _identities.end();
+      _reidBuffer.push(reportedTrackId(trackId), known ? identity->second.id : -1, known ? identity->second.confidence : 0.0f,
+                       feature.data(), static_cast<int32_t>(feature.size()), now);
+    }
+
+    // Compare the tracks that started on this frame against the buffer only
+    for (int i = 0; i < faces.detectedNum && !_reidBuffer.empty(); i++)
+    {
+      const int32_t trackId = faces.trackIds[i];
+      if (_activeTracks.count(trackId))
+      {
+        continue;
+      }
+
+      // Cached, so the track does not need another extraction to be buffered when it ends
+      try
+      {
+        bool extracted = false;
+        feature = extractCachedFeature(stream, trackId, faces.tokens[i], static_cast<float>(faces.rects[i].width * faces.rects[i].height),
+                                       std::abs(faces.angles.yaw[i]) + std::abs(faces.angles.pitch[i]), extracted);
+      }
+      catch (const std::exception &e)
+      {
+        Logger::log(LogLevel::Error, TAG, "Failed to extract feature of track %d: %s", trackId, e.what());
+        continue;
+      }
+
+      ReidBuffer::Entry entry;
+      if (!_reidBuffer.match(feature.data(), static_cast<int32_t>(feature.size()), now, entry))
+      {
+        continue;
+      }
+
+      _aliases[trackId] = entry.trackId;
+      _nativeTrackIds[entry.trackId] = trackId;
+      TrackIdentity &identity = _identities[trackId];
+      identity.id = entry.id;
+      identity.confidence = entry.confidence;
+      identity.searched = entry.id >= 0;
+      identity.framesSinceSearch = 0;
+      identity.feature = entry.feature;
+      // Continue the fused mean of the ended track when it is still held, otherwise seed it with the buffered feature
+      if (_fusionEnabled && !_featureFusion.rename(entry.trackId, trackId))
+      {
+        _featureFusion.add(trackId, entry.feature.data(), static_cast<int32_t>(entry.feature.size()), 1.0f);
+      }
+    }
+  }
+
+  int32_t HybridSession::reportedTrackId(int32_t trackId) const
+  {
+    auto it = _aliases.find(trackId);
+    return it == _aliases.end() ? trackId : it->second;
+  }
+
+  int32_t HybridSession::nativeTrackId(int32_t trackId) const
+  {
+    auto it = _nativeTrackIds.find(trackId);
+    return it == _nativeTrackIds.end() ? trackId : it->second;
+  }
+
+  void HybridSession::setReidConfig(const ReidConfig &config)
+  {
+    _reidEnabled = config.enabled;
+    _reidBuffer.configure(
+        static_cast<float>(config.threshold),
+        config.ttl.value_or(3000.0),
+        static_cast<size_t>(std::max(1.0, config.capacity.value_or(16.0))));
+    if (!_reidEnabled)
     {
-      throw std::runtime_error("Failed to set track mode num smooth cache frame with error code: " + std::to_string(result));
+      _reidBuffer.clear();
+      _aliases.clear();
+      _nativeTrackIds.clear();
     }
   }
 
-  void HybridSession::setTrackModeDetectInterval(double num)
+  void HybridSession::retainIdentities(const std::vector<int32_t> &trackIds)
   {
-    if (_session == nullptr)
+    if (_identities.empty())
     {
-      throw std::runtime_error("HybridSession is not initialized");
+      return;
     }
-
-    HResult result = HFSessionSetTrackModeDetectInterval(_session, static_cast<HInt32>(num));
-    if (result != HSUCCEED)
+    const std::unordered_set<int32_t> alive(trackIds.begin(), trackIds.end());
+    for (auto it = _identities.begin(); it != _identities.end();)
     {
-      throw std::runtime_error("Failed to set track mode detect interval with error code: " + std::to_string(result));
+      it = alive.count(it->first) ? std::next(it) : _identities.erase(it);
     }
   }
 
-  std::vector<FaceData> HybridSession::executeFaceTrack(const std::shared_ptr<HybridImageStreamSpec> &imageStream)
+  std::vector<IdentifyResult> HybridSession::identify(const std::shared_ptr<HybridImageStreamSpec> &imageStream, const std::optional<IdentifyOptions> &options)
   {
     if (!_session)
     {
       throw std::runtime_error("HybridSession is null");
     }
-    if (!imageStream)
-    {
-      throw std::runtime_error("Image stream is null");
-    }
 
     auto nitroImageStream = std::dynamic_pointer_cast<HybridImageStream>(imageStream);
     if (!nitroImageStream)
@@ -140,94 +981,85 @@ namespace margelo::nitro::nitroinspireface
       throw std::runtime_error("Invalid image stream type");
     }
 
-    HFImageStream nativeStream = nitroImageStream->getNativeHandle();
-
-    HFMultipleFaceData results{};
-    HResult status = HFExecuteFaceTrack(_session, nativeStream, &results);
-    if (status != HSUCCEED)
-    {
-      throw std::runtime_error("Face track failed with code: " + std::to_string(status));
-    }
+    const bool useTrackCache = options.has_value() ? options->useTrackCache.value_or(true) : true;
+    const uint32_t retryInterval = static_cast<uint32_t>(std::max(1.0, options.has_value() ? options->retryInterval.value_or(15.0) : 15.0));
 
-    Logger::log(LogLevel::Info, TAG, "Face track results: %d", results.detectedNum);
+    HFImageStream nativeStream = nitroImageStream->getNativeHandle();
+    HFMultipleFaceData faces{};
+    trackFaces(*nitroImageStream, faces);
 
-    // Process results into a vector
-    std::vector<FaceData> faceDataVector;
-    if (results.detectedNum > 0)
+    std::vector<IdentifyResult> results;
+    results.reserve(faces.detectedNum);
+    std::vector<float> feature;
+    for (int i = 0; i < faces.detectedNum; i++)
     {
-      faceDataVector.reserve(results.detectedNum);
+      const int32_t trackId = faces.trackIds[i];
+      TrackIdentity &identity = _identities[trackId];
 
-      for (int i = 0; i < results.detectedNum; ++i)
+      // Known tracks keep their identity, unknown ones are searched again every retryInterval frames
+      const bool known = useTrackCache && identity.searched && (identity.id >= 0 || identity.framesSinceSearch + 1 < retryInterval);
+      bool cached = known;
+      if (known)
       {
-        // Construct FaceRect
-        FaceRect rect(
-            static_cast<double>(results.rects[i].x),
-            static_cast<double>(results.rects[i].y),
-            static_cast<double>(results.rects[i].width),
-            static_cast<double>(results.rects[i].height));
-
-        // Extract track ID and confidence
-        double trackId = static_cast<double>(results.trackIds[i]);
-        double detConfidence = static_cast<double>(results.detConfidence[i]);
-
-        // Construct FaceEulerAngle
-        FaceEulerAngle angles(
-            static_cast<double>(results.angles.roll[i]),
-            static_cast<double>(results.angles.yaw[i]),
-            static_cast<double>(results.angles.pitch[i]));
-
-        // Handle token data
-        std::shared_ptr<margelo::nitro::ArrayBuffer> buffer;
-        if (results.tokens[i].size > 0 && results.tokens[i].data != nullptr)
+        identity.framesSinceSearch++;
+      }
+      else
+      {
+        // Prefer the fused feature of the track over the single frame
+        bool hasFeature = _featureFusion.get(trackId, feature);
+        if (!hasFeature)
         {
           try
           {
-            buffer = margelo::nitro::ArrayBuffer::copy(
-                static_cast<uint8_t *>(results.tokens[i].data),
-                results.tokens[i].size);
+            feature = extractFeature(nativeStream, faces.tokens[i]);
+            hasFeature = true;
           }
-          catch (const std::bad_alloc &e)
+          catch (const std::exception &e)
           {
-            buffer = margelo::nitro::ArrayBuffer::allocate(0); // Fallback to empty buffer
+            Logger::log(LogLevel::Error, TAG, "Failed to extract feature of track %d: %s", trackId, e.what());
           }
         }
-        else
+
+        if (hasFeature)
         {
-          buffer = margelo::nitro::ArrayBuffer::allocate(0); // Empty buffer if no valid token
+          int64_t id = -1;
+          float confidence = 0.0f;
+          FeatureGallery &gallery = FeatureGallery::shared();
+          {
+            std::lock_guard<std::mutex> lock(gallery.hubMutex());
+            gallery.search(feature.data(), static_cast<int32_t>(feature.size()), id, confidence);
+          }
+          identity.id = id;
+          identity.confidence = confidence;
+          identity.searched = true;
+          identity.framesSinceSearch = 0;
+          identity.feature = feature;
         }
-
-        // Add FaceData to vector
-        faceDataVector.emplace_back(rect, trackId, detConfidence, angles, buffer);
+        cached = false;
       }
-    }
-
-    return faceDataVector;
-  }
 
-  std::shared_ptr<ArrayBuffer> HybridSession::extractFaceFeature(const std::shared_ptr<HybridImageStreamSpec> &imageStream, const std::shared_ptr<ArrayBuffer> &faceToken)
-  {
-    if (!imageStream || !faceToken)
-    {
-      throw std::runtime_error("Invalid input parameters");
+      results.emplace_back(
+          FaceRect(faces.rects[i].x + _roiX, faces.rects[i].y + _roiY, faces.rects[i].width, faces.rects[i].height),
+          static_cast<double>(reportedTrackId(trackId)),
+          static_cast<double>(identity.id),
+          static_cast<double>(identity.confidence),
+          cached);
     }
 
-    // Cast the image stream to HybridImageStream
-    auto nitroImageStream = std::dynamic_pointer_cast<HybridImageStream>(imageStream);
-    if (!nitroImageStream)
+    if (!useTrackCache)
     {
-      throw std::runtime_error("Failed to cast to HybridImageStream");
+      _identities.clear();
     }
+    return results;
+  }
 
-    // Create face token struct
-    HFFaceBasicToken token = {};
-    token.size = static_cast<HInt32>(faceToken->size());
-    token.data = faceToken->data();
-
+  std::vector<float> HybridSession::extractFeature(HFImageStream stream, HFFaceBasicToken token)
+  {
     // Initialize feature struct with zeros
     HFFaceFeature feature = {};
 
     // Extract face feature
-    HResult result = HFFaceFeatureExtract(_session, nitroImageStream->getNativeHandle(), token, &feature);
+    HResult result = HFFaceFeatureExtract(_session, stream, token, &feature);
 
     if (result != HSUCCEED)
     {
@@ -254,14 +1086,253 @@ namespace margelo::nitro::nitroinspireface
       throw std::runtime_error("Invalid feature size: expected " + std::to_string(expectedLength) + " floats");
     }
 
+    return std::vector<float>(feature.data, feature.data + feature.size);
+  }
+
+  std::shared_ptr<ArrayBuffer> HybridSession::extractFaceFeature(const std::shared_ptr<HybridImageStreamSpec> &imageStream, const std::shared_ptr<ArrayBuffer> &faceToken)
+  {
+    if (!imageStream || !faceToken)
+    {
+      throw std::runtime_error("Invalid input parameters");
+    }
+
+    // Cast the image stream to HybridImageStream
+    auto nitroImageStream = std::dynamic_pointer_cast<HybridImageStream>(imageStream);
+    if (!nitroImageStream)
+    {
+      throw std::runtime_error("Failed to cast to HybridImageStream");
+    }
+
+    // Create face token struct
+    HFFaceBasicToken token = {};
+    token.size = static_cast<HInt32>(faceToken->size());
+    token.data = faceToken->data();
+
+    std::vector<float> feature = extractFeature(nitroImageStream->getNativeHandle(), token);
+
     // Create an ArrayBuffer from the feature data
     auto featureBuffer = ArrayBuffer::copy(
-        reinterpret_cast<uint8_t *>(feature.data),
-        feature.size * sizeof(float));
+        reinterpret_cast<uint8_t *>(feature.data()),
+        feature.size() * sizeof(float));
 
     return featureBuffer;
   }
 
+  void HybridSession::setFeatureCacheConfig(const FeatureCacheConfig &config)
+  {
+    _featureCache.configure(
+        config.ttl.value_or(2000.0),
+        static_cast<float>(config.sizeGrowth.value_or(1.25)),
+        static_cast<float>(config.poseImprovement.value_or(10.0)));
+  }
+
+  std::shared_ptr<ArrayBuffer> HybridSession::extractFaceFeatureCached(const std::shared_ptr<HybridImageStreamSpec> &imageStream, const FaceData &face)
+  {
+    if (!imageStream || !face.token)
+    {
+      throw std::runtime_error("Invalid input parameters");
+    }
+
+    auto nitroImageStream = std::dynamic_pointer_cast<HybridImageStream>(imageStream);
+    if (!nitroImageStream)
+    {
+      throw std::runtime_error("Failed to cast to HybridImageStream");
+    }
+
+    std::vector<float> feature = extractCachedFeature(nitroImageStream->getNativeHandle(), face);
+    return ArrayBuffer::copy(reinterpret_cast<uint8_t *>(feature.data()), feature.size() * sizeof(float));
+  }
+
+  std::vector<float> HybridSession::extractCachedFeature(HFImageStream stream, const FaceData &face)
+  {
+    HFFaceBasicToken token = {};
+    token.size = static_cast<HInt32>(face.token->size());
+    token.data = face.token->data();
+
+    bool extracted = false;
+    return extractCachedFeature(
+        stream,
+        nativeTrackId(static_cast<int32_t>(face.trackId)),
+        token,
+        static_cast<float>(face.rect.width * face.rect.height),
+        static_cast<float>(std::abs(face.angle.yaw) + std::abs(face.angle.pitch)),
+        extracted);
+  }
+
+  std::vector<float> HybridSession::extractCachedFeature(HFImageStream stream, int32_t trackId, HFFaceBasicToken token, float faceArea, float poseError, bool &extracted)
+  {
+    const auto now = TrackFeatureCache::Clock::now();
+    const std::vector<float> *cached = _featureCache.lookup(trackId, faceArea, poseError, now);
+    extracted = cached == nullptr;
+    if (cached != nullptr)
+    {
+      return *cached;
+    }
+
+    std::vector<float> feature = extractFeature(stream, token);
+    _featureCache.store(trackId, feature.data(), static_cast<int32_t>(feature.size()), faceArea, poseError, now);
+    _freshFeatures.insert(trackId);
+    return feature;
+  }
+
+  void HybridSession::clearFeatureCache()
+  {
+    _featureCache.clear();
+  }
+
+  void HybridSession::enableBestShot(const BestShotConfig &config, const std::function<void(double /* trackId */, const std::vector<BestShot> & /* shots */)> &onTrackEnd)
+  {
+    _bestShots.configure(
+        static_cast<size_t>(std::max(1.0, config.count.value_or(3.0))),
+        static_cast<float>(config.minScore.value_or(0.0)));
+    _onBestShots = onTrackEnd;
+  }
+
+  void HybridSession::disableBestShot()
+  {
+    _onBestShots.reset();
+    _bestShots.clear();
+  }
+
+  void HybridSession::flushBestShots()
+  {
+    if (_onBestShots.has_value())
+    {
+      emitBestShots(_bestShots.finishAll());
+    }
+  }
+
+  float HybridSession::faceQuality(const HFMultipleFaceData &faces, int index)
+  {
+    // Quality needs enableFaceQuality on the session, fall back to the detector confidence
+    HFloat quality = 0.0f;
+    if (HFFaceQualityDetect(_session, faces.tokens[index], &quality) != HSUCCEED)
+    {
+      quality = faces.detConfidence[index];
+    }
+    return std::clamp(static_cast<float>(quality), 0.0f, 1.0f);
+  }
+
+  void HybridSession::setTrackFusionConfig(const TrackFusionConfig &config)
+  {
+    _fusionEnabled = config.enabled;
+    _featureFusion.configure(
+        static_cast<uint32_t>(std::max(1.0, config.interval.value_or(1.0))),
+        static_cast<float>(config.minWeight.value_or(0.0)),
+        config.retainFor.value_or(1000.0));
+    if (!_fusionEnabled)
+    {
+      _featureFusion.clear();
+    }
+  }
+
+  std::optional<std::shared_ptr<ArrayBuffer>> HybridSession::getTrackFeature(double trackId)
+  {
+    std::vector<float> fused;
+    if (!_featureFusion.get(nativeTrackId(static_cast<int32_t>(trackId)), fused))
+    {
+      return std::nullopt;
+    }
+    return ArrayBuffer::copy(reinterpret_cast<uint8_t *>(fused.data()), fused.size() * sizeof(float));
+  }
+
+  void HybridSession::fuseTrackFeatures(HFImageStream stream, const HFMultipleFaceData &faces)
+  {
+    for (int i = 0; i < faces.detectedNum; i++)
+    {
+      if (!_featureFusion.due(faces.trackIds[i]))
+      {
+        continue;
+      }
+
+      // Due frames are always extracted, only a feature extracted earlier on this frame is reused. The fresh
+      // feature goes back to the cache so recognition and re-identification share it
+      const int32_t trackId = faces.trackIds[i];
+      const HFaceRect &rect = faces.rects[i];
+      const float poseError = std::abs(faces.angles.yaw[i]) + std::abs(faces.angles.pitch[i]);
+      try
+      {
+        const std::vector<float> *cached = _freshFeatures.count(trackId) ? _featureCache.peek(trackId) : nullptr;
+        std::vector<float> feature;
+        if (cached != nullptr)
+        {
+          feature = *cached;
+        }
+        else
+        {
+          feature = extractFeature(stream, faces.tokens[i]);
+          _featureCache.store(trackId, feature.data(), static_cast<int32_t>(feature.size()), static_cast<float>(rect.width * rect.height), poseError,
+                              TrackFeatureCache::Clock::now());
+          _freshFeatures.insert(trackId);
+        }
+        // Blurry or turned faces still count, just less than clean frontal ones
+        const float weight = faceQuality(faces, i) * poseScore(faces, i);
+        _featureFusion.add(trackId, feature.data(), static_cast<int32_t>(feature.size()), weight);
+      }
+      catch (const std::exception &e)
+      {
+        Logger::log(LogLevel::Error, TAG, "Failed to fuse feature of track %d: %s", trackId, e.what());
+      }
+    }
+  }
+
+  void HybridSession::collectBestShots(HFImageStream stream, const HFMultipleFaceData &faces, const std::vector<int32_t> &trackIds)
+  {
+    // Aligned crops are 112 pixels wide, smaller faces are upscaled and lose detail
+    constexpr float kAlignedSize = 112.0f;
+
+    for (int i = 0; i < faces.detectedNum; i++)
+    {
+      const float quality = faceQuality(faces, i);
+      const float sizeScore = std::min(1.0f, static_cast<float>(std::min(faces.rects[i].width, faces.rects[i].height)) / kAlignedSize);
+      const float score = quality * poseScore(faces, i) * sizeScore;
+      if (!_bestShots.accepts(faces.trackIds[i], score))
+      {
+        continue;
+      }
+
+      // Only frames that make the top list pay for the alignment crop
+      BestShotSelector::Shot shot;
+      if (HFFaceGetFaceAlignmentImage(_session, stream, faces.tokens[i], &shot.bitmap) != HSUCCEED || shot.bitmap == nullptr)
+      {
+        continue;
+      }
+      shot.score = score;
+      shot.quality = quality;
+      shot.rect = faces.rects[i];
+      shot.rect.x += _roiX;
+      shot.rect.y += _roiY;
+      shot.roll = faces.angles.roll[i];
+      shot.yaw = faces.angles.yaw[i];
+      shot.pitch = faces.angles.pitch[i];
+      _bestShots.offer(faces.trackIds[i], shot);
+    }
+
+    emitBestShots(_bestShots.finish(trackIds));
+  }
+
+  void HybridSession::emitBestShots(std::vector<BestShotSelector::TrackShots> tracks)
+  {
+    for (auto &[trackId, shots] : tracks)
+    {
+      std::vector<BestShot> result;
+      result.reserve(shots.size());
+      for (const auto &shot : shots)
+      {
+        result.emplace_back(
+            static_cast<double>(shot.score),
+            static_cast<double>(shot.quality),
+            FaceRect(shot.rect.x, shot.rect.y, shot.rect.width, shot.rect.height),
+            FaceEulerAngle(shot.roll, shot.yaw, shot.pitch),
+            std::make_shared<HybridImageBitmap>(shot.bitmap));
+      }
+      if (_onBestShots.has_value())
+      {
+        _onBestShots.value()(static_cast<double>(reportedTrackId(trackId)), result);
+      }
+    }
+  }
+
   bool HybridSession::multipleFacePipelineProcess(const std::shared_ptr<HybridImageStreamSpec> &imageStream, const std::vector<FaceData> &multipleFaceData, const SessionCustomParameter &parameter)
   {
     if (_session == nullptr)
@@ -296,70 +1367,16 @@ namespace margelo::nitro::nitroinspireface
     hfParam.enable_detect_mode_landmark = parameter.enableDetectModeLandmark ? 1 : 0;
 
     // Convert vector<FaceData> to HFMultipleFaceData
-    HFMultipleFaceData hfFaces = {};
-    memset(&hfFaces, 0, sizeof(HFMultipleFaceData));
-
-    // Set the number of faces
-    hfFaces.detectedNum = static_cast<HInt32>(multipleFaceData.size());
-
-    if (hfFaces.detectedNum > 0)
+    NativeFaces nativeFaces;
+    for (const auto &face : multipleFaceData)
     {
-      // Allocate arrays for face data
-      hfFaces.rects = new HFaceRect[hfFaces.detectedNum];
-      hfFaces.trackIds = new HInt32[hfFaces.detectedNum];
-      hfFaces.detConfidence = new HFloat[hfFaces.detectedNum];
-      hfFaces.tokens = new HFFaceBasicToken[hfFaces.detectedNum];
-
-      // Allocate angle data
-      hfFaces.angles.roll = new HFloat[hfFaces.detectedNum];
-      hfFaces.angles.yaw = new HFloat[hfFaces.detectedNum];
-      hfFaces.angles.pitch = new HFloat[hfFaces.detectedNum];
-
-      // Copy data from FaceData vector to HFMultipleFaceData
-      for (int i = 0; i < hfFaces.detectedNum; i++)
-      {
-        // Copy rect
-        hfFaces.rects[i].x = static_cast<HInt32>(multipleFaceData[i].rect.x);
-        hfFaces.rects[i].y = static_cast<HInt32>(multipleFaceData[i].rect.y);
-        hfFaces.rects[i].width = static_cast<HInt32>(multipleFaceData[i].rect.width);
-        hfFaces.rects[i].height = static_cast<HInt32>(multipleFaceData[i].rect.height);
-
-        // Copy track ID
-        hfFaces.trackIds[i] = static_cast<HInt32>(multipleFaceData[i].trackId);
-
-        // Copy detection confidence
-        hfFaces.detConfidence[i] = static_cast<HFloat>(multipleFaceData[i].detConfidence);
-
-        // Copy angles
-        hfFaces.angles.roll[i] = static_cast<HFloat>(multipleFaceData[i].angle.roll);
-        hfFaces.angles.yaw[i] = static_cast<HFloat>(multipleFaceData[i].angle.yaw);
-        hfFaces.angles.pitch[i] = static_cast<HFloat>(multipleFaceData[i].angle.pitch);
-
-        // Copy token
-        hfFaces.tokens[i].size = static_cast<HInt32>(multipleFaceData[i].token->size());
-        hfFaces.tokens[i].data = multipleFaceData[i].token->data();
-      }
+      nativeFaces.add(face, nativeTrackId(static_cast<int32_t>(face.trackId)), *nitroImageStream);
     }
+    HFMultipleFaceData hfFaces = nativeFaces.view();
 
     // Process the faces
     HResult result = HFMultipleFacePipelineProcess(_session, nitroImageStream->getNativeHandle(), &hfFaces, hfParam);
 
-    // Clean up allocated memory
-    if (hfFaces.rects)
-      delete[] hfFaces.rects;
-    if (hfFaces.trackIds)
-      delete[] hfFaces.trackIds;
-    if (hfFaces.detConfidence)
-      delete[] hfFaces.detConfidence;
-    if (hfFaces.tokens)
-      delete[] hfFaces.tokens;
-    if (hfFaces.angles.roll)
-      delete[] hfFaces.angles.roll;
-    if (hfFaces.angles.yaw)
-      delete[] hfFaces.angles.yaw;
-    if (hfFaces.angles.pitch)
-      delete[] hfFaces.angles.pitch;
-
     if (result != HSUCCEED)
     {
       Logger::log(LogLevel::Error, "HybridSession", "Failed to process faces in pipeline, error code: %ld", result);
@@ -602,4 +1619,107 @@ namespace margelo::nitro::nitroinspireface
     return std::make_shared<HybridImageBitmap>(alignedBitmap);
   }
 
+  std::shared_ptr<HybridImageBitmapSpec> HybridSession::getFaceAlignmentImages(const std::shared_ptr<HybridImageStreamSpec> &imageStream, const std::vector<std::shared_ptr<ArrayBuffer>> &faceTokens,
+                                                                               const std::optional<std::shared_ptr<HybridImageBitmapSpec>> &atlas)
+  {
+    // Side of an aligned face crop, every cell of the atlas holds one
+    constexpr int32_t kCellSize = 112;
+    constexpr int32_t kChannels = 3;
+
+    if (_session == nullptr)
+    {
+      Logger::log(LogLevel::Error, "HybridSession", "HybridSession is not initialized");
+      throw std::runtime_error("HybridSession is not initialized");
+    }
+
+    auto nitroImageStream = std::dynamic_pointer_cast<HybridImageStream>(imageStream);
+    if (!nitroImageStream)
+    {
+      throw std::runtime_error("Failed to cast to HybridImageStream");
+    }
+
+    const int32_t count = static_cast<int32_t>(faceTokens.size());
+    std::shared_ptr<HybridImageBitmap> target;
+    uint8_t *atlasPixels = nullptr;
+    int32_t columns = 0;
+    int32_t rows = 0;
+    if (atlas.has_value() && atlas.value())
+    {
+      target = std::dynamic_pointer_cast<HybridImageBitmap>(atlas.value());
+      if (!target)
+      {
+        throw std::runtime_error("Failed to cast to HybridImageBitmap");
+      }
+      const HFImageBitmapData &atlasData = target->getNativeData();
+      columns = atlasData.width / kCellSize;
+      rows = atlasData.height / kCellSize;
+      if (atlasData.channels != kChannels || columns * rows < count)
+      {
+        throw std::runtime_error("Atlas of " + std::to_string(atlasData.width) + "x" + std::to_string(atlasData.height) + "x" + std::to_string(atlasData.channels) +
+                                 " cannot hold " + std::to_string(count) + " aligned faces");
+      }
+      atlasPixels = target->getWritableData();
+    }
+    else
+    {
+      if (count == 0)
+      {
+        throw std::runtime_error("No face tokens given");
+      }
+      columns = static_cast<int32_t>(std::ceil(std::sqrt(static_cast<double>(count))));
+      rows = (count + columns - 1) / columns;
+      auto pixels = ArrayBuffer::allocate(static_cast<size_t>(columns) * rows * kCellSize * kCellSize * kChannels);
+      // The new atlas owns the buffer and stays writable in place, also when it is passed back for the next frame
+      target = std::make_shared<HybridImageBitmap>(pixels, columns * kCellSize, rows * kCellSize, kChannels, true);
+      atlasPixels = pixels->data();
+    }
+
+    const size_t atlasStride = static_cast<size_t>(target->getNativeData().width) * kChannels;
+    const size_t cellStride = static_cast<size_t>(kCellSize) * kChannels;
+    auto cellOrigin = [&](int32_t cell)
+    {
+      return atlasPixels + static_cast<size_t>(cell / columns) * kCellSize * atlasStride + static_cast<size_t>(cell % columns) * cellStride;
+    };
+
+    // The C API allocates a bitmap per crop, it is copied into its cell and released right away
+    for (int32_t i = 0; i < count; i++)
+    {
+      HFFaceBasicToken token = {};
+      token.size = static_cast<HInt32>(faceTokens[i]->size());
+      token.data = faceTokens[i]->data();
+      HFImageBitmap alignedBitmap = nullptr;
+      HResult result = HFFaceGetFaceAlignmentImage(_session, nitroImageStream->getNativeHandle(), token, &alignedBitmap);
+      if (result != HSUCCEED || alignedBitmap == nullptr)
+      {
+        throw std::runtime_error("Failed to get face alignment image " + std::to_string(i) + " with error code: " + std::to_string(result));
+      }
+
+      HFImageBitmapData aligned{};
+      result = HFImageBitmapGetData(alignedBitmap, &aligned);
+      if (result != HSUCCEED || aligned.width != kCellSize || aligned.height != kCellSize || aligned.channels != kChannels)
+      {
+        HFReleaseImageBitmap(alignedBitmap);
+        throw std::runtime_error("Unexpected face alignment image with error code: " + std::to_string(result));
+      }
+      uint8_t *cell = cellOrigin(i);
+      for (int32_t y = 0; y < kCellSize; y++)
+      {
+        std::memcpy(cell + y * atlasStride, aligned.data + y * cellStride, cellStride);
+      }
+      HFReleaseImageBitmap(alignedBitmap);
+    }
+
+    // Clear the cells left over, a reused atlas would still show the faces of an earlier frame
+    for (int32_t i = count; i < columns * rows; i++)
+    {
+      uint8_t *cell = cellOrigin(i);
+      for (int32_t y = 0; y < kCellSize; y++)
+      {
+        std::memset(cell + y * atlasStride, 0, cellStride);
+      }
+    }
+
+    return target;
+  }
+
 } // namespace margelo::nitro::nitroinspireface
@@ -8,8 +8,38 @@
 #include "FaceInteractionsAction.hpp"
 #include "FaceAttributeResult.hpp"
 #include "FaceData.hpp"
+#include "FeatureCacheConfig.hpp"
+#include "TrackFeatureCache.hpp"
+#include "TrackFeatureFusion.hpp"
+#include "TrackFusionConfig.hpp"
+#include "IdentifyOptions.hpp"
+#include "IdentifyResult.hpp"
+#include "ReidBuffer.hpp"
+#include "ReidConfig.hpp"
+#include "AdaptiveTrackController.hpp"
+#include "AdaptiveTrackingConfig.hpp"
+#include "AdaptiveTrackingState.hpp"
+#include "PipelineScheduler.hpp"
+#include "PipelineFaceResult.hpp"
+#include "PipelineStage.hpp"
+#include "ScheduledPipelineResult.hpp"
+#include "TrackAttributeCache.hpp"
+#include "AttributeCacheConfig.hpp"
+#include "MotionGate.hpp"
+#include "MotionGateConfig.hpp"
+#include "CascadeDetector.hpp"
+#include "CoarseToFineConfig.hpp"
+#include "CoarseToFineResult.hpp"
+#include "BestShotSelector.hpp"
+#include "BestShot.hpp"
+#include "BestShotConfig.hpp"
+#include "HybridImageStream.hpp"
 #include "inspireface.h"
 #include <NitroModules/ArrayBuffer.hpp>
+#include <functional>
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 namespace margelo::nitro::nitroinspireface
@@ -46,6 +76,27 @@ namespace margelo::nitro::nitroinspireface
     void setTrackModeDetectInterval(double num) override;
     std::vector<FaceData> executeFaceTrack(const std::shared_ptr<HybridImageStreamSpec> &imageStream) override;
     std::shared_ptr<ArrayBuffer> extractFaceFeature(const std::shared_ptr<HybridImageStreamSpec> &imageStream, const std::shared_ptr<ArrayBuffer> &faceToken) override;
+    void setFeatureCacheConfig(const FeatureCacheConfig &config) override;
+    std::shared_ptr<ArrayBuffer> extractFaceFeatureCached(const std::shared_ptr<HybridImageStreamSpec> &imageStream, const FaceData &face) override;
+    void clearFeatureCache() override;
+    void enableBestShot(const BestShotConfig &config, const std::function<void(double /* trackId */, const std::vector<BestShot> & /* shots */)> &onTrackEnd) override;
+    void disableBestShot() override;
+    void flushBestShots() override;
+    void setTrackFusionConfig(const TrackFusionConfig &config) override;
+    std::optional<std::shared_ptr<ArrayBuffer>> getTrackFeature(double trackId) override;
+    std::vector<IdentifyResult> identify(const std::shared_ptr<HybridImageStreamSpec> &imageStream, const std::optional<IdentifyOptions> &options) override;
+    void setReidConfig(const ReidConfig &config) override;
+    void setAdaptiveTrackingConfig(const AdaptiveTrackingConfig &config) override;
+    AdaptiveTrackingState getAdaptiveTrackingState() override;
+    void setFrameBudget(double budget) override;
+    ScheduledPipelineResult scheduledPipelineProcess(const std::shared_ptr<HybridImageStreamSpec> &imageStream, const std::vector<FaceData> &multipleFaceData, const SessionCustomParameter &parameter) override;
+    void setAttributeCacheConfig(const AttributeCacheConfig &config) override;
+    std::vector<PipelineFaceResult> multipleFacePipelineProcessCached(const std::shared_ptr<HybridImageStreamSpec> &imageStream, const std::vector<FaceData> &multipleFaceData, const SessionCustomParameter &parameter) override;
+    void clearAttributeCache() override;
+    void setMotionGateConfig(const MotionGateConfig &config) override;
+    double getMotionScore() override;
+    void setCoarseToFineConfig(const CoarseToFineConfig &config) override;
+    CoarseToFineResult detectCoarseToFine(const std::shared_ptr<HybridImageStreamSpec> &imageStream) override;
     bool multipleFacePipelineProcess(const std::shared_ptr<HybridImageStreamSpec> &imageStream, const std::vector<FaceData> &multipleFaceData, const SessionCustomParameter &parameter) override;
     std::vector<double> getRGBLivenessConfidence() override;
     std::vector<double> getFaceQualityConfidence() override;
@@ -54,9 +105,80 @@ namespace margelo::nitro::nitroinspireface
     std::vector<FaceInteractionsAction> getFaceInteractionActionsResult() override;
     std::vector<FaceAttributeResult> getFaceAttributeResult() override;
     std::shared_ptr<HybridImageBitmapSpec> getFaceAlignmentImage(const std::shared_ptr<HybridImageStreamSpec> &imageStream, const std::shared_ptr<ArrayBuffer> &faceToken) override;
+    std::shared_ptr<HybridImageBitmapSpec> getFaceAlignmentImages(const std::shared_ptr<HybridImageStreamSpec> &imageStream, const std::vector<std::shared_ptr<ArrayBuffer>> &faceTokens,
+                                                                  const std::optional<std::shared_ptr<HybridImageBitmapSpec>> &atlas) override;
+
+  private:
+    struct TrackIdentity
+    {
+      int64_t id = -1;
+      float confidence = 0.0f;
+      bool searched = false;
+      uint32_t framesSinceSearch = 0;
+      std::vector<float> feature;
+    };
+
+    // Run the tracker and all per-track bookkeeping, throws on failure
+    void trackFaces(const HybridImageStream &imageStream, HFMultipleFaceData &faces);
+    void applyTrackSettings(const AdaptiveTrackController::Settings &settings);
+    // Whether the motion gate lets this frame skip tracking
+    bool isStaticFrame(const HybridImageStream &stream);
+    // Per-track bookkeeping after every track call
+    void updateTracks(HFImageStream stream, const HFMultipleFaceData &faces);
+    void retainIdentities(const std::vector<int32_t> &trackIds);
+    void reidentifyTracks(HFImageStream stream, const HFMultipleFaceData &faces, const std::vector<int32_t> &trackIds);
+    // Track IDs of re-identified tracks are reported as the ID of the track they continue
+    int32_t reportedTrackId(int32_t trackId) const;
+    int32_t nativeTrackId(int32_t trackId) const;
+    // Extract the feature of a tracked face, throws on failure
+    std::vector<float> extractFeature(HFImageStream stream, HFFaceBasicToken token);
+    // Feature of a tracked face through the track feature cache
+    std::vector<float> extractCachedFeature(HFImageStream stream, const FaceData &face);
+    // Cached feature of a native trackId, extracted is set when it had to be extracted on this call
+    std::vector<float> extractCachedFeature(HFImageStream stream, int32_t trackId, HFFaceBasicToken token, float faceArea, float poseError, bool &extracted);
+    // Run the HF_ENABLE_* stages in options on the picked faces and store their output in results
+    void runPipelineStages(const HybridImageStream &stream, HInt32 options, const std::vector<FaceData> &faces, const std::vector<size_t> &picks, std::vector<PipelineFaceResult> &results);
+    // Face quality between 0 and 1, the detection confidence when quality is not enabled
+    float faceQuality(const HFMultipleFaceData &faces, int index);
+    void fuseTrackFeatures(HFImageStream stream, const HFMultipleFaceData &faces);
+    // Extract one feature per track for re-identification when fusion is off
+    void sampleReidFeatures(HFImageStream stream, const HFMultipleFaceData &faces);
+    // Score the faces of the latest track call and emit the tracks that ended
+    void collectBestShots(HFImageStream stream, const HFMultipleFaceData &faces, const std::vector<int32_t> &trackIds);
+    void emitBestShots(std::vector<BestShotSelector::TrackShots> tracks);
 
   private:
     HFSession _session;
+    TrackFeatureCache _featureCache;
+    TrackAttributeCache _attributeCache;
+    BestShotSelector _bestShots;
+    TrackFeatureFusion _featureFusion;
+    bool _fusionEnabled = false;
+    // Tracks whose cached feature was extracted on the current frame
+    std::unordered_set<int32_t> _freshFeatures;
+    std::unordered_map<int32_t, TrackIdentity> _identities;
+    ReidBuffer _reidBuffer;
+    bool _reidEnabled = false;
+    std::unordered_map<int32_t, int32_t> _aliases;
+    // Reverse of _aliases, reported trackId to native trackId
+    std::unordered_map<int32_t, int32_t> _nativeTrackIds;
+    std::unordered_set<int32_t> _activeTracks;
+    AdaptiveTrackController _adaptiveController;
+    bool _adaptiveEnabled = false;
+    // Detect interval and preview size chosen by the caller, the SDK defaults until set
+    AdaptiveTrackController::Settings _trackSettings{20, 192};
+    double _lastTrackTime = 0.0;
+    // Offset of the region of interest of the latest tracked stream, added to reported rects
+    int32_t _roiX = 0;
+    int32_t _roiY = 0;
+    PipelineScheduler _pipelineScheduler;
+    MotionGate _motionGate;
+    bool _motionGateEnabled = false;
+    std::vector<FaceData> _lastFaces;
+    // Region of interest of the frame _lastFaces and the gate reference come from
+    FaceRect _lastFacesRoi{0, 0, 0, 0};
+    CascadeDetector _cascadeDetector;
+    std::optional<std::function<void(double, const std::vector<BestShot> &)>> _onBestShots;
   };
 
 } // namespace margelo::nitro::nitroinspireface
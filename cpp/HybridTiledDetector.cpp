@@ -0,0 +1,213 @@
+#include "HybridTiledDetector.hpp"
+#include "HybridImageStream.hpp"
+#include "DetectionMerge.hpp"
+#include "ImageKernels.hpp"
+#include <NitroModules/NitroLogger.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+
+namespace margelo::nitro::nitroinspireface
+{
+  namespace
+  {
+    // Offsets of the tiles along one axis, spread evenly so the last tile ends on the border
+    std::vector<int32_t> tileOffsets(int32_t length, int32_t tile, float overlap)
+    {
+      if (length <= tile)
+      {
+        return {0};
+      }
+      const float step = std::max(1.0f, static_cast<float>(tile) * (1.0f - overlap));
+      const int32_t count = static_cast<int32_t>(std::ceil(static_cast<float>(length - tile) / step)) + 1;
+      std::vector<int32_t> offsets(count);
+      for (int32_t i = 0; i < count; i++)
+      {
+        offsets[i] = static_cast<int32_t>(std::lround(static_cast<double>(i) * (length - tile) / (count - 1)));
+      }
+      return offsets;
+    }
+  } // namespace
+
+  HybridTiledDetector::HybridTiledDetector() : HybridObject(TAG) {}
+
+  HybridTiledDetector::HybridTiledDetector(std::vector<HFSession> sessions, int32_t tileSize, float overlap, bool includeFullFrame, float iouThreshold)
+      : HybridObject(TAG), _sessions(std::move(sessions)), _tileSize(std::max<int32_t>(32, tileSize)),
+        _overlap(std::clamp(overlap, 0.0f, 0.9f)), _includeFullFrame(includeFullFrame), _iouThreshold(iouThreshold) {}
+
+  void HybridTiledDetector::cleanup()
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (HFSession session : _sessions)
+    {
+      HFReleaseInspireFaceSession(session);
+    }
+    _sessions.clear();
+  }
+
+  HybridTiledDetector::~HybridTiledDetector()
+  {
+    cleanup();
+  }
+
+  void HybridTiledDetector::dispose()
+  {
+    cleanup();
+  }
+
+  double HybridTiledDetector::getWorkerCount()
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return static_cast<double>(_sessions.size());
+  }
+
+  std::vector<HybridTiledDetector::Tile> HybridTiledDetector::layoutTiles(int32_t width, int32_t height) const
+  {
+    std::vector<Tile> tiles;
+    // The whole frame goes first, it is the slowest item when the detector downscales it
+    if (_includeFullFrame && (width > _tileSize || height > _tileSize))
+    {
+      tiles.push_back({0, 0, width, height});
+    }
+    const int32_t tileWidth = std::min(width, _tileSize);
+    const int32_t tileHeight = std::min(height, _tileSize);
+    for (int32_t y : tileOffsets(height, tileHeight, _overlap))
+    {
+      for (int32_t x : tileOffsets(width, tileWidth, _overlap))
+      {
+        tiles.push_back({x, y, tileWidth, tileHeight});
+      }
+    }
+    return tiles;
+  }
+
+  std::vector<DetectedFace> HybridTiledDetector::detect(const std::shared_ptr<HybridImageStreamSpec> &imageStream)
+  {
+    auto nitroImageStream = std::dynamic_pointer_cast<HybridImageStream>(imageStream);
+    if (!nitroImageStream)
+    {
+      throw std::runtime_error("Failed to cast to HybridImageStream");
+    }
+    // Tiles are laid out on the upright frame, so rects come out the way executeFaceTrack reports them
+    std::vector<uint8_t> uprightPixels;
+    HFImageBitmapData upright{};
+    const HFImageBitmapData *source = nitroImageStream->getUprightData(uprightPixels, upright);
+    if (source == nullptr)
+    {
+      throw std::runtime_error("Image stream was not created from a bitmap");
+    }
+    const HFImageBitmapData &frame = *source;
+    if (frame.channels != 3)
+    {
+      throw std::runtime_error("Tiled detection needs a 3 channel bitmap, got " + std::to_string(frame.channels));
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_sessions.empty())
+    {
+      throw std::runtime_error("HybridTiledDetector is disposed");
+    }
+
+    const std::vector<Tile> tiles = layoutTiles(frame.width, frame.height);
+    const size_t stride = static_cast<size_t>(frame.width) * 3;
+    std::vector<std::vector<Detection>> found(_sessions.size());
+    std::atomic<size_t> next{0};
+    std::atomic<HResult> failure{HSUCCEED};
+
+    auto worker = [&](size_t index)
+    {
+      std::vector<uint8_t> buffer;
+      for (size_t t = next++; t < tiles.size(); t = next++)
+      {
+        const Tile &tile = tiles[t];
+        HFImageData image = {};
+        image.width = tile.width;
+        image.height = tile.height;
+        image.format = HF_STREAM_BGR;
+        image.rotation = HF_CAMERA_ROTATION_0;
+        if (tile.width == frame.width)
+        {
+          // Full-width tiles are contiguous rows of the frame, no copy needed
+          image.data = frame.data + static_cast<size_t>(tile.y) * stride;
+        }
+        else
+        {
+          buffer.resize(static_cast<size_t>(tile.width) * tile.height * 3);
+          copyRegion(frame.data, frame.width, 3, tile.x, tile.y, tile.width, tile.height, buffer.data());
+          image.data = buffer.data();
+        }
+
+        HFImageStream stream = nullptr;
+        HResult status = HFCreateImageStream(&image, &stream);
+        if (status != HSUCCEED)
+        {
+          failure = status;
+          continue;
+        }
+        HFMultipleFaceData faces = {};
+        status = HFExecuteFaceTrack(_sessions[index], stream, &faces);
+        if (status == HSUCCEED)
+        {
+          for (int i = 0; i < faces.detectedNum; i++)
+          {
+            found[index].push_back({
+                static_cast<float>(faces.rects[i].x + tile.x),
+                static_cast<float>(faces.rects[i].y + tile.y),
+                static_cast<float>(faces.rects[i].width),
+                static_cast<float>(faces.rects[i].height),
+                faces.detConfidence[i],
+                faces.angles.roll[i],
+                faces.angles.yaw[i],
+                faces.angles.pitch[i],
+            });
+          }
+        }
+        else
+        {
+          failure = status;
+        }
+        HFReleaseImageStream(stream);
+      }
+    };
+
+    const size_t threadCount = std::min(_sessions.size(), tiles.size());
+    std::vector<std::thread> threads;
+    threads.reserve(threadCount);
+    for (size_t i = 0; i < threadCount; i++)
+    {
+      threads.emplace_back(worker, i);
+    }
+    for (auto &thread : threads)
+    {
+      thread.join();
+    }
+    if (failure != HSUCCEED)
+    {
+      throw std::runtime_error("Tiled detection failed with code: " + std::to_string(failure.load()));
+    }
+
+    std::vector<Detection> detections;
+    for (auto &faces : found)
+    {
+      detections.insert(detections.end(), faces.begin(), faces.end());
+    }
+    nonMaxSuppression(detections, _iouThreshold);
+    Logger::log(LogLevel::Info, TAG, "Detected %zu faces in %zu tiles", detections.size(), tiles.size());
+
+    std::vector<DetectedFace> results;
+    results.reserve(detections.size());
+    for (const auto &face : detections)
+    {
+      results.emplace_back(
+          FaceRect(face.x, face.y, face.width, face.height),
+          static_cast<double>(face.confidence),
+          FaceEulerAngle(face.roll, face.yaw, face.pitch));
+    }
+    return results;
+  }
+
+} // namespace margelo::nitro::nitroinspireface
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "HybridTiledDetectorSpec.hpp"
+#include "HybridImageStreamSpec.hpp"
+#include "DetectedFace.hpp"
+#include "inspireface.h"
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace margelo::nitro::nitroinspireface
+{
+  /**
+   * Implementation of the HybridTiledDetector module
+   */
+  class HybridTiledDetector : public virtual HybridTiledDetectorSpec
+  {
+  public:
+    // Default constructor required for autolink
+    HybridTiledDetector();
+
+    // Constructor with the session pool, one session per worker
+    HybridTiledDetector(std::vector<HFSession> sessions, int32_t tileSize, float overlap, bool includeFullFrame, float iouThreshold);
+
+    // Destructor
+    ~HybridTiledDetector() override;
+
+    // Override dispose to clean up resources
+    void dispose() override;
+
+  private:
+    // Private cleanup method used by both dispose and destructor
+    void cleanup();
+
+  public:
+    // Properties
+    double getWorkerCount() override;
+
+    // Methods
+    std::vector<DetectedFace> detect(const std::shared_ptr<HybridImageStreamSpec> &imageStream) override;
+
+  private:
+    struct Tile
+    {
+      int32_t x;
+      int32_t y;
+      int32_t width;
+      int32_t height;
+    };
+
+    std::vector<Tile> layoutTiles(int32_t width, int32_t height) const;
+
+  private:
+    std::mutex _mutex;
+    std::vector<HFSession> _sessions;
+    int32_t _tileSize = 640;
+    float _overlap = 0.25f;
+    bool _includeFullFrame = true;
+    float _iouThreshold = 0.4f;
+  };
+
+} // namespace margelo::nitro::nitroinspireface
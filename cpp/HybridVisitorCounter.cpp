@@ -0,0 +1,233 @@
+#include "HybridVisitorCounter.hpp"
+#include "FeatureMath.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+
+namespace margelo::nitro::nitroinspireface
+{
+  namespace
+  {
+    // Expired visitors are dropped in batches, not on every update
+    constexpr uint32_t kPruneInterval = 256;
+    // Visits kept for window queries, per centroid slot
+    constexpr size_t kVisitsPerCentroid = 64;
+  } // namespace
+
+  HybridVisitorCounter::HybridVisitorCounter() : HybridObject(TAG) {}
+
+  HybridVisitorCounter::HybridVisitorCounter(float threshold, int32_t maxCentroids, double halfLife, double retention)
+      : HybridObject(TAG), _threshold(threshold), _maxCentroids(static_cast<size_t>(std::max<int32_t>(1, maxCentroids))),
+        _halfLife(std::max(1.0, halfLife)), _retention(std::max(0.0, retention)) {}
+
+  void HybridVisitorCounter::dispose()
+  {
+    reset();
+  }
+
+  double HybridVisitorCounter::getCentroidCount()
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return static_cast<double>(_centroids.size());
+  }
+
+  float HybridVisitorCounter::decayedWeight(const Centroid &centroid, double timestamp) const
+  {
+    const double elapsed = std::max(0.0, timestamp - centroid.updatedAt);
+    return centroid.weight * static_cast<float>(std::exp2(-elapsed / _halfLife));
+  }
+
+  double HybridVisitorCounter::update(const std::shared_ptr<ArrayBuffer> &feature, double timestamp)
+  {
+    if (!feature || feature->size() == 0 || feature->size() % sizeof(float) != 0)
+    {
+      throw std::runtime_error("Invalid feature data");
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    const int32_t length = static_cast<int32_t>(feature->size() / sizeof(float));
+    if (_featureLength == 0)
+    {
+      _featureLength = length;
+      _matrix.reserve(_maxCentroids * length);
+    }
+    else if (length != _featureLength)
+    {
+      throw std::runtime_error("Invalid feature size. Expected " + std::to_string(_featureLength * sizeof(float)) +
+                               " bytes but got " + std::to_string(feature->size()));
+    }
+
+    const float *data = reinterpret_cast<const float *>(feature->data());
+    _query.assign(data, data + length);
+    l2Normalize(_query.data(), length);
+
+    // The centroid set is bounded, so a linear scan stays well under a millisecond
+    size_t best = _centroids.size();
+    float bestSimilarity = _threshold;
+    for (size_t slot = 0; slot < _centroids.size(); slot++)
+    {
+      const float similarity = dotProduct(_query.data(), _matrix.data() + slot * length, length);
+      if (similarity >= bestSimilarity)
+      {
+        bestSimilarity = similarity;
+        best = slot;
+      }
+    }
+
+    int64_t visitorId = 0;
+    if (best < _centroids.size())
+    {
+      // Blend the face in, weighted by how much recent evidence the centroid holds
+      Centroid &centroid = _centroids[best];
+      const float weight = decayedWeight(centroid, timestamp);
+      float *row = _matrix.data() + best * length;
+      for (int32_t i = 0; i < length; i++)
+      {
+        row[i] = row[i] * weight + _query[i];
+      }
+      l2Normalize(row, length);
+      centroid.weight = weight + 1.0f;
+      centroid.updatedAt = std::max(centroid.updatedAt, timestamp);
+      visitorId = centroid.visitorId;
+
+      Visit &visit = _visits[visitorId];
+      visit.firstSeen = visit.sightings == 0 ? timestamp : std::min(visit.firstSeen, timestamp);
+      visit.lastSeen = std::max(visit.lastSeen, timestamp);
+      visit.sightings++;
+    }
+    else
+    {
+      size_t slot = _centroids.size();
+      if (slot < _maxCentroids)
+      {
+        _centroids.push_back({});
+        _matrix.resize(_centroids.size() * length);
+      }
+      else
+      {
+        // Replace the visitor with the least recent evidence, its visit stays countable
+        float lowest = decayedWeight(_centroids[0], timestamp);
+        slot = 0;
+        for (size_t i = 1; i < _centroids.size(); i++)
+        {
+          const float weight = decayedWeight(_centroids[i], timestamp);
+          if (weight < lowest)
+          {
+            lowest = weight;
+            slot = i;
+          }
+        }
+      }
+
+      visitorId = _nextVisitorId++;
+      _centroids[slot] = {visitorId, 1.0f, timestamp};
+      std::memcpy(_matrix.data() + slot * length, _query.data(), length * sizeof(float));
+      _visits[visitorId] = {timestamp, timestamp, 1};
+    }
+
+    if (++_updatesSincePrune >= kPruneInterval)
+    {
+      prune(timestamp);
+    }
+    return static_cast<double>(visitorId);
+  }
+
+  void HybridVisitorCounter::prune(double timestamp)
+  {
+    _updatesSincePrune = 0;
+    const double expiry = timestamp - _retention;
+    for (auto it = _visits.begin(); it != _visits.end();)
+    {
+      it = it->second.lastSeen < expiry ? _visits.erase(it) : std::next(it);
+    }
+
+    // Hard cap for very busy cameras, drop the visits that ended first
+    const size_t maxVisits = _maxCentroids * kVisitsPerCentroid;
+    if (_visits.size() > maxVisits)
+    {
+      std::vector<double> lastSeen;
+      lastSeen.reserve(_visits.size());
+      for (const auto &[id, visit] : _visits)
+      {
+        lastSeen.push_back(visit.lastSeen);
+      }
+      const size_t excess = _visits.size() - maxVisits;
+      std::nth_element(lastSeen.begin(), lastSeen.begin() + excess, lastSeen.end());
+      const double cutoff = lastSeen[excess];
+      for (auto it = _visits.begin(); it != _visits.end();)
+      {
+        it = it->second.lastSeen < cutoff ? _visits.erase(it) : std::next(it);
+      }
+    }
+
+    // A centroid without a visit record would count its person again, drop it too
+    const size_t length = static_cast<size_t>(_featureLength);
+    for (size_t slot = 0; slot < _centroids.size();)
+    {
+      if (_visits.find(_centroids[slot].visitorId) != _visits.end())
+      {
+        slot++;
+        continue;
+      }
+      const size_t last = _centroids.size() - 1;
+      if (slot != last)
+      {
+        _centroids[slot] = _centroids[last];
+        std::memcpy(_matrix.data() + slot * length, _matrix.data() + last * length, length * sizeof(float));
+      }
+      _centroids.pop_back();
+      _matrix.resize(_centroids.size() * length);
+    }
+  }
+
+  double HybridVisitorCounter::getUniqueCount(double start, double end)
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    size_t count = 0;
+    for (const auto &[id, visit] : _visits)
+    {
+      if (visit.firstSeen <= end && visit.lastSeen >= start)
+      {
+        count++;
+      }
+    }
+    return static_cast<double>(count);
+  }
+
+  std::vector<VisitorStats> HybridVisitorCounter::getVisitors(double start, double end)
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::vector<VisitorStats> visitors;
+    for (const auto &[id, visit] : _visits)
+    {
+      if (visit.firstSeen <= end && visit.lastSeen >= start)
+      {
+        visitors.emplace_back(
+            static_cast<double>(id),
+            visit.firstSeen,
+            visit.lastSeen,
+            visit.lastSeen - visit.firstSeen,
+            static_cast<double>(visit.sightings));
+      }
+    }
+
+    std::sort(visitors.begin(), visitors.end(), [](const VisitorStats &a, const VisitorStats &b)
+              { return a.id < b.id; });
+    return visitors;
+  }
+
+  void HybridVisitorCounter::reset()
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _featureLength = 0;
+    _matrix.clear();
+    _centroids.clear();
+    _visits.clear();
+    _nextVisitorId = 0;
+    _updatesSincePrune = 0;
+  }
+
+} // namespace margelo::nitro::nitroinspireface
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "HybridVisitorCounterSpec.hpp"
+#include "VisitorStats.hpp"
+#include <NitroModules/ArrayBuffer.hpp>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace margelo::nitro::nitroinspireface
+{
+  /**
+   * Implementation of the HybridVisitorCounter module
+   */
+  class HybridVisitorCounter : public virtual HybridVisitorCounterSpec
+  {
+  public:
+    // Default constructor required for autolink
+    HybridVisitorCounter();
+
+    // Constructor with counting settings
+    HybridVisitorCounter(float threshold, int32_t maxCentroids, double halfLife, double retention);
+
+    // Destructor
+    ~HybridVisitorCounter() override = default;
+
+    // Override dispose to clean up resources
+    void dispose() override;
+
+  public:
+    // Properties
+    double getCentroidCount() override;
+
+    // Methods
+    double update(const std::shared_ptr<ArrayBuffer> &feature, double timestamp) override;
+    double getUniqueCount(double start, double end) override;
+    std::vector<VisitorStats> getVisitors(double start, double end) override;
+    void reset() override;
+
+  private:
+    struct Centroid
+    {
+      int64_t visitorId;
+      float weight;
+      double updatedAt;
+    };
+
+    struct Visit
+    {
+      double firstSeen;
+      double lastSeen;
+      int64_t sightings;
+    };
+
+    // Both helpers expect _mutex to be held
+    float decayedWeight(const Centroid &centroid, double timestamp) const;
+    void prune(double timestamp);
+
+  private:
+    std::mutex _mutex;
+    float _threshold = 0.48f;
+    size_t _maxCentroids = 256;
+    double _halfLife = 60000.0;
+    double _retention = 3600000.0;
+
+    // One normalized row per centroid, never larger than _maxCentroids rows
+    int32_t _featureLength = 0;
+    std::vector<float> _matrix;
+    std::vector<Centroid> _centroids;
+    std::vector<float> _query;
+
+    std::unordered_map<int64_t, Visit> _visits;
+    int64_t _nextVisitorId = 0;
+    uint32_t _updatesSincePrune = 0;
+  };
+
+} // namespace margelo::nitro::nitroinspireface
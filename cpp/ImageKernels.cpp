@@ -0,0 +1,382 @@
+#include "ImageKernels.hpp"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+namespace margelo::nitro::nitroinspireface
+{
+  namespace
+  {
+    // Fixed point precision of the interpolation weights
+    constexpr int32_t kWeightBits = 11;
+    constexpr int32_t kWeightOne = 1 << kWeightBits;
+
+    /**
+     * Source positions sampled along one axis of the region, computed once per call
+     * so the per-pixel loop only does lookups.
+     */
+    struct AxisTable
+    {
+      // Nearest pixel, first bilinear tap or start of the averaged span
+      std::vector<int32_t> first;
+      // Second bilinear tap or end of the averaged span
+      std::vector<int32_t> second;
+      // Weight of the second bilinear tap
+      std::vector<int32_t> weight;
+    };
+
+    AxisTable buildAxis(int32_t offset, int32_t length, int32_t count, Resampling resampling)
+    {
+      AxisTable table;
+      table.first.resize(count);
+      table.second.resize(count);
+      table.weight.resize(count);
+      for (int32_t i = 0; i < count; i++)
+      {
+        switch (resampling)
+        {
+        case Resampling::Nearest:
+        {
+          const int32_t position = static_cast<int32_t>((static_cast<int64_t>(2 * i + 1) * length) / (2 * count));
+          table.first[i] = offset + std::min(position, length - 1);
+          break;
+        }
+        case Resampling::Bilinear:
+        {
+          // Pixel centers aligned, taps clamped to the region
+          const float position = std::clamp((i + 0.5f) * length / count - 0.5f, 0.0f, static_cast<float>(length - 1));
+          const int32_t index = static_cast<int32_t>(position);
+          table.first[i] = offset + index;
+          table.second[i] = offset + std::min(index + 1, length - 1);
+          table.weight[i] = static_cast<int32_t>((position - index) * kWeightOne);
+          break;
+        }
+        case Resampling::Area:
+        {
+          const int32_t start = static_cast<int32_t>(static_cast<int64_t>(i) * length / count);
+          const int32_t end = static_cast<int32_t>(static_cast<int64_t>(i + 1) * length / count);
+          table.first[i] = offset + start;
+          table.second[i] = offset + std::max(start + 1, end);
+          break;
+        }
+        }
+      }
+      return table;
+    }
+
+    // Reorder the channels of a row of pixels
+    void swizzleRow(const uint8_t *in, int32_t srcChannels, uint8_t *out, int32_t dstChannels, const uint8_t *map, int32_t count)
+    {
+      int32_t i = 0;
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+      // 16 pixels per step, deinterleaved loads and stores do the shuffling
+      if ((srcChannels == 3 || srcChannels == 4) && (dstChannels == 3 || dstChannels == 4))
+      {
+        const uint8x16_t opaque = vdupq_n_u8(0xFF);
+        for (; i + 16 <= count; i += 16)
+        {
+          uint8x16_t planes[4];
+          if (srcChannels == 3)
+          {
+            const uint8x16x3_t pixels = vld3q_u8(in + i * 3);
+            planes[0] = pixels.val[0];
+            planes[1] = pixels.val[1];
+            planes[2] = pixels.val[2];
+          }
+          else
+          {
+            const uint8x16x4_t pixels = vld4q_u8(in + i * 4);
+            planes[0] = pixels.val[0];
+            planes[1] = pixels.val[1];
+            planes[2] = pixels.val[2];
+            planes[3] = pixels.val[3];
+          }
+          if (dstChannels == 3)
+          {
+            uint8x16x3_t pixels;
+            pixels.val[0] = map[0] == kOpaqueChannel ? opaque : planes[map[0]];
+            pixels.val[1] = map[1] == kOpaqueChannel ? opaque : planes[map[1]];
+            pixels.val[2] = map[2] == kOpaqueChannel ? opaque : planes[map[2]];
+            vst3q_u8(out + i * 3, pixels);
+          }
+          else
+          {
+            uint8x16x4_t pixels;
+            pixels.val[0] = map[0] == kOpaqueChannel ? opaque : planes[map[0]];
+            pixels.val[1] = map[1] == kOpaqueChannel ? opaque : planes[map[1]];
+            pixels.val[2] = map[2] == kOpaqueChannel ? opaque : planes[map[2]];
+            pixels.val[3] = map[3] == kOpaqueChannel ? opaque : planes[map[3]];
+            vst4q_u8(out + i * 4, pixels);
+          }
+        }
+      }
+#endif
+      for (; i < count; i++)
+      {
+        const uint8_t *pixel = in + i * srcChannels;
+        for (int32_t c = 0; c < dstChannels; c++)
+        {
+          out[i * dstChannels + c] = map[c] == kOpaqueChannel ? 0xFF : pixel[map[c]];
+        }
+      }
+    }
+
+    /**
+     * Source of one output row. Output pixel dx samples the unrotated position
+     * ux = ax * dx + bx, uy = ay * dx + by, which covers all four quarter turns.
+     */
+    struct RowSource
+    {
+      const uint8_t *src;
+      size_t stride;
+      const AxisTable &xs;
+      const AxisTable &ys;
+      int32_t ax, bx, ay, by;
+    };
+
+    using RowSampler = void (*)(const RowSource &, int32_t, uint8_t *);
+
+    // One sampler per mode and channel count, so the pixel loops have no branches and fixed trip counts
+    template <int32_t Channels>
+    void nearestRow(const RowSource &row, int32_t count, uint8_t *out)
+    {
+      for (int32_t dx = 0; dx < count; dx++, out += Channels)
+      {
+        const int32_t ux = row.ax * dx + row.bx;
+        const int32_t uy = row.ay * dx + row.by;
+        const uint8_t *pixel = row.src + static_cast<size_t>(row.ys.first[uy]) * row.stride + static_cast<size_t>(row.xs.first[ux]) * Channels;
+        for (int32_t c = 0; c < Channels; c++)
+        {
+          out[c] = pixel[c];
+        }
+      }
+    }
+
+    template <int32_t Channels>
+    inline void bilinearPixel(const uint8_t *row0, const uint8_t *row1, size_t x0, size_t x1, int32_t wx, int32_t wy, uint8_t *out)
+    {
+      for (int32_t c = 0; c < Channels; c++)
+      {
+        const int32_t top = row0[x0 + c] * kWeightOne + (row0[x1 + c] - row0[x0 + c]) * wx;
+        const int32_t bottom = row1[x0 + c] * kWeightOne + (row1[x1 + c] - row1[x0 + c]) * wx;
+        out[c] = static_cast<uint8_t>((top * kWeightOne + (bottom - top) * wy + (1 << (2 * kWeightBits - 1))) >> (2 * kWeightBits));
+      }
+    }
+
+    template <int32_t Channels>
+    void bilinearRow(const RowSource &row, int32_t count, uint8_t *out)
+    {
+      if (row.ay == 0)
+      {
+        // No turn or a half turn, the whole row reads the same two source rows
+        const uint8_t *row0 = row.src + static_cast<size_t>(row.ys.first[row.by]) * row.stride;
+        const uint8_t *row1 = row.src + static_cast<size_t>(row.ys.second[row.by]) * row.stride;
+        const int32_t wy = row.ys.weight[row.by];
+        for (int32_t dx = 0; dx < count; dx++, out += Channels)
+        {
+          const int32_t ux = row.ax * dx + row.bx;
+          bilinearPixel<Channels>(row0, row1, static_cast<size_t>(row.xs.first[ux]) * Channels,
+                                  static_cast<size_t>(row.xs.second[ux]) * Channels, row.xs.weight[ux], wy, out);
+        }
+        return;
+      }
+      // Quarter turns walk down a source column
+      for (int32_t dx = 0; dx < count; dx++, out += Channels)
+      {
+        const int32_t ux = row.bx;
+        const int32_t uy = row.ay * dx + row.by;
+        bilinearPixel<Channels>(row.src + static_cast<size_t>(row.ys.first[uy]) * row.stride,
+                                row.src + static_cast<size_t>(row.ys.second[uy]) * row.stride,
+                                static_cast<size_t>(row.xs.first[ux]) * Channels, static_cast<size_t>(row.xs.second[ux]) * Channels,
+                                row.xs.weight[ux], row.ys.weight[uy], out);
+      }
+    }
+
+    template <int32_t Channels>
+    void areaRow(const RowSource &row, int32_t count, uint8_t *out)
+    {
+      for (int32_t dx = 0; dx < count; dx++, out += Channels)
+      {
+        const int32_t ux = row.ax * dx + row.bx;
+        const int32_t uy = row.ay * dx + row.by;
+        // 64 bits, a large region averaged into few pixels overflows 32
+        uint64_t sum[Channels] = {};
+        for (int32_t sy = row.ys.first[uy]; sy < row.ys.second[uy]; sy++)
+        {
+          const uint8_t *pixel = row.src + static_cast<size_t>(sy) * row.stride + static_cast<size_t>(row.xs.first[ux]) * Channels;
+          for (int32_t sx = row.xs.first[ux]; sx < row.xs.second[ux]; sx++, pixel += Channels)
+          {
+            for (int32_t c = 0; c < Channels; c++)
+            {
+              sum[c] += pixel[c];
+            }
+          }
+        }
+        const uint64_t area = static_cast<uint64_t>(row.ys.second[uy] - row.ys.first[uy]) * static_cast<uint64_t>(row.xs.second[ux] - row.xs.first[ux]);
+        for (int32_t c = 0; c < Channels; c++)
+        {
+          out[c] = static_cast<uint8_t>((sum[c] + area / 2) / area);
+        }
+      }
+    }
+
+    RowSampler rowSampler(Resampling resampling, int32_t channels)
+    {
+      static constexpr RowSampler kNearest[] = {&nearestRow<1>, &nearestRow<2>, &nearestRow<3>, &nearestRow<4>};
+      static constexpr RowSampler kBilinear[] = {&bilinearRow<1>, &bilinearRow<2>, &bilinearRow<3>, &bilinearRow<4>};
+      static constexpr RowSampler kArea[] = {&areaRow<1>, &areaRow<2>, &areaRow<3>, &areaRow<4>};
+      switch (resampling)
+      {
+      case Resampling::Nearest:
+        return kNearest[channels - 1];
+      case Resampling::Area:
+        return kArea[channels - 1];
+      case Resampling::Bilinear:
+      default:
+        return kBilinear[channels - 1];
+      }
+    }
+
+    bool isIdentity(const PixelTransform &transform, int32_t channels)
+    {
+      if (transform.dstChannels != channels)
+      {
+        return false;
+      }
+      for (int32_t c = 0; c < channels; c++)
+      {
+        if (transform.channelMap[c] != c)
+        {
+          return false;
+        }
+      }
+      return true;
+    }
+  } // namespace
+
+  void copyRegion(const uint8_t *src, int32_t srcWidth, int32_t channels,
+                  int32_t x, int32_t y, int32_t width, int32_t height, uint8_t *dst)
+  {
+    const size_t srcStride = static_cast<size_t>(srcWidth) * channels;
+    const size_t rowBytes = static_cast<size_t>(width) * channels;
+    const uint8_t *in = src + static_cast<size_t>(y) * srcStride + static_cast<size_t>(x) * channels;
+    for (int32_t row = 0; row < height; row++)
+    {
+      std::memcpy(dst + row * rowBytes, in + row * srcStride, rowBytes);
+    }
+  }
+
+  void resizeImage(const uint8_t *src, int32_t srcWidth, int32_t srcHeight, int32_t channels,
+                   uint8_t *dst, int32_t dstWidth, int32_t dstHeight)
+  {
+    PixelTransform transform;
+    transform.width = srcWidth;
+    transform.height = srcHeight;
+    transform.dstWidth = dstWidth;
+    transform.dstHeight = dstHeight;
+    transform.dstChannels = channels;
+    transform.resampling = dstWidth <= srcWidth && dstHeight <= srcHeight ? Resampling::Area : Resampling::Bilinear;
+    transformImage(src, srcWidth, srcHeight, channels, transform, dst);
+  }
+
+  void transformImage(const uint8_t *src, int32_t srcWidth, int32_t srcHeight, int32_t channels,
+                      const PixelTransform &transform, uint8_t *dst)
+  {
+    if (channels < 1 || channels > 4 || transform.width <= 0 || transform.height <= 0 || transform.x < 0 || transform.y < 0 ||
+        transform.x + transform.width > srcWidth || transform.y + transform.height > srcHeight)
+    {
+      throw std::runtime_error("Transform region lies outside the " + std::to_string(srcWidth) + "x" + std::to_string(srcHeight) + " image");
+    }
+
+    const int32_t rotation = transform.rotation & 3;
+    const size_t srcStride = static_cast<size_t>(srcWidth) * channels;
+    const size_t dstStride = static_cast<size_t>(transform.dstWidth) * transform.dstChannels;
+
+    // Crops and pure channel reordering copy rows without resampling
+    if (rotation == 0 && transform.dstWidth == transform.width && transform.dstHeight == transform.height)
+    {
+      if (isIdentity(transform, channels))
+      {
+        copyRegion(src, srcWidth, channels, transform.x, transform.y, transform.width, transform.height, dst);
+        return;
+      }
+      for (int32_t row = 0; row < transform.height; row++)
+      {
+        swizzleRow(src + static_cast<size_t>(transform.y + row) * srcStride + static_cast<size_t>(transform.x) * channels,
+                   channels, dst + row * dstStride, transform.dstChannels, transform.channelMap, transform.width);
+      }
+      return;
+    }
+
+    // Size of the output before rotation, the tables are indexed in that space
+    const bool quarterTurn = rotation == 1 || rotation == 3;
+    const int32_t unrotatedWidth = quarterTurn ? transform.dstHeight : transform.dstWidth;
+    const int32_t unrotatedHeight = quarterTurn ? transform.dstWidth : transform.dstHeight;
+    const AxisTable xs = buildAxis(transform.x, transform.width, unrotatedWidth, transform.resampling);
+    const AxisTable ys = buildAxis(transform.y, transform.height, unrotatedHeight, transform.resampling);
+
+    // Rows are sampled in source channel order, then reordered unless the map is the identity
+    const RowSampler sample = rowSampler(transform.resampling, channels);
+    const bool swizzle = !isIdentity(transform, channels);
+    std::vector<uint8_t> sampled(swizzle ? static_cast<size_t>(transform.dstWidth) * channels : 0);
+    for (int32_t dy = 0; dy < transform.dstHeight; dy++)
+    {
+      RowSource row{src, srcStride, xs, ys, 1, 0, 0, dy};
+      switch (rotation)
+      {
+      case 1:
+        row.ax = 0, row.bx = dy, row.ay = -1, row.by = unrotatedHeight - 1;
+        break;
+      case 2:
+        row.ax = -1, row.bx = unrotatedWidth - 1, row.ay = 0, row.by = unrotatedHeight - 1 - dy;
+        break;
+      case 3:
+        row.ax = 0, row.bx = unrotatedWidth - 1 - dy, row.ay = 1, row.by = 0;
+        break;
+      }
+
+      uint8_t *out = dst + dy * dstStride;
+      if (!swizzle)
+      {
+        sample(row, transform.dstWidth, out);
+        continue;
+      }
+      sample(row, transform.dstWidth, sampled.data());
+      swizzleRow(sampled.data(), channels, out, transform.dstChannels, transform.channelMap, transform.dstWidth);
+    }
+  }
+
+  void fillRect(uint8_t *dst, int32_t width, int32_t height, int32_t channels,
+                int32_t x0, int32_t y0, int32_t x1, int32_t y1, const uint8_t *pixel)
+  {
+    x0 = std::max(x0, 0);
+    y0 = std::max(y0, 0);
+    x1 = std::min(x1, width);
+    y1 = std::min(y1, height);
+    if (x0 >= x1 || y0 >= y1)
+    {
+      return;
+    }
+
+    // Build the first row by doubling, then every other row is a single memcpy of it
+    const size_t stride = static_cast<size_t>(width) * channels;
+    const size_t rowBytes = static_cast<size_t>(x1 - x0) * channels;
+    uint8_t *first = dst + static_cast<size_t>(y0) * stride + static_cast<size_t>(x0) * channels;
+    std::memcpy(first, pixel, channels);
+    for (size_t filled = channels; filled < rowBytes; filled *= 2)
+    {
+      std::memcpy(first + filled, first, std::min(filled, rowBytes - filled));
+    }
+    for (int32_t y = y0 + 1; y < y1; y++)
+    {
+      std::memcpy(first + static_cast<size_t>(y - y0) * stride, first, rowBytes);
+    }
+  }
+
+} // namespace margelo::nitro::nitroinspireface
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace margelo::nitro::nitroinspireface
+{
+  /**
+   * Pixel kernels on interleaved 8-bit images with 1 to 4 channels and tightly packed rows.
+   * They work on raw buffers so streams, bitmaps and detectors can share them without
+   * going through an HFImageBitmap.
+   */
+
+  enum class Resampling
+  {
+    Nearest,
+    Bilinear,
+    // Average of the covered source pixels, for downscaling
+    Area,
+  };
+
+  // Channel map entry that writes an opaque alpha instead of a source channel
+  constexpr uint8_t kOpaqueChannel = 0xFF;
+
+  /**
+   * Crop, rotation, scale and channel reordering applied in a single pass.
+   */
+  struct PixelTransform
+  {
+    // Source region
+    int32_t x = 0;
+    int32_t y = 0;
+    int32_t width = 0;
+    int32_t height = 0;
+    // Clockwise quarter turns applied to the region
+    int32_t rotation = 0;
+    // Size of the output, after rotation
+    int32_t dstWidth = 0;
+    int32_t dstHeight = 0;
+    int32_t dstChannels = 0;
+    // Source channel of every output channel, or kOpaqueChannel
+    uint8_t channelMap[4] = {0, 1, 2, 3};
+    Resampling resampling = Resampling::Bilinear;
+  };
+
+  // Copy a rectangle of an image into a tightly packed buffer of width * height * channels bytes
+  void copyRegion(const uint8_t *src, int32_t srcWidth, int32_t channels,
+                  int32_t x, int32_t y, int32_t width, int32_t height, uint8_t *dst);
+
+  // Resize an image, averaging the covered source pixels when shrinking and interpolating bilinearly when growing
+  void resizeImage(const uint8_t *src, int32_t srcWidth, int32_t srcHeight, int32_t channels,
+                   uint8_t *dst, int32_t dstWidth, int32_t dstHeight);
+
+  // Apply a transform, dst holds dstWidth * dstHeight * dstChannels bytes. Throws when the region does not lie inside the image
+  void transformImage(const uint8_t *src, int32_t srcWidth, int32_t srcHeight, int32_t channels,
+                      const PixelTransform &transform, uint8_t *dst);
+
+  // Fill [x0, x1) x [y0, y1) with one pixel of channels bytes, clipped to the image
+  void fillRect(uint8_t *dst, int32_t width, int32_t height, int32_t channels,
+                int32_t x0, int32_t y0, int32_t x1, int32_t y1, const uint8_t *pixel);
+
+} // namespace margelo::nitro::nitroinspireface
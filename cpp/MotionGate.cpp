@@ -0,0 +1,122 @@
+#include "MotionGate.hpp"
+#include <algorithm>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+namespace margelo::nitro::nitroinspireface
+{
+  namespace
+  {
+    // Thumbnail size, enough to see a person walk in at a few thousand bytes
+    constexpr int32_t kGridWidth = 64;
+    constexpr int32_t kGridHeight = 48;
+
+    // Sum of absolute differences of two byte arrays
+    uint32_t sumAbsoluteDifferences(const uint8_t *a, const uint8_t *b, size_t length)
+    {
+      size_t i = 0;
+      uint32_t sum = 0;
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+      uint32x4_t acc = vdupq_n_u32(0);
+      for (; i + 16 <= length; i += 16)
+      {
+        const uint8x16_t diff = vabdq_u8(vld1q_u8(a + i), vld1q_u8(b + i));
+        acc = vpadalq_u16(acc, vpaddlq_u8(diff));
+      }
+#if defined(__aarch64__)
+      sum = vaddvq_u32(acc);
+#else
+      uint32x2_t pair = vadd_u32(vget_low_u32(acc), vget_high_u32(acc));
+      sum = vget_lane_u32(vpadd_u32(pair, pair), 0);
+#endif
+#endif
+      // Branch-free form the compiler vectorizes on other targets
+      for (; i < length; i++)
+      {
+        const int32_t diff = static_cast<int32_t>(a[i]) - static_cast<int32_t>(b[i]);
+        sum += static_cast<uint32_t>(diff < 0 ? -diff : diff);
+      }
+      return sum;
+    }
+  } // namespace
+
+  void MotionGate::configure(float threshold, uint32_t maxSkippedFrames)
+  {
+    _threshold = std::max(0.0f, threshold);
+    _maxSkippedFrames = maxSkippedFrames;
+    reset();
+  }
+
+  bool MotionGate::update(const uint8_t *data, int32_t width, int32_t height, int32_t channels, size_t stride)
+  {
+    if (data == nullptr || width < kGridWidth || height < kGridHeight)
+    {
+      _score = 1.0f;
+      return false;
+    }
+
+    downsample(data, width, height, channels, stride != 0 ? stride : static_cast<size_t>(width) * channels);
+    if (_reference.size() != _current.size() || width != _width || height != _height)
+    {
+      // First frame or a new resolution, nothing to compare with
+      _score = 1.0f;
+    }
+    else
+    {
+      const uint32_t sad = sumAbsoluteDifferences(_current.data(), _reference.data(), _current.size());
+      _score = static_cast<float>(sad) / (255.0f * static_cast<float>(_current.size()));
+    }
+
+    if (_score < _threshold && _skippedFrames < _maxSkippedFrames)
+    {
+      _skippedFrames++;
+      return true;
+    }
+
+    _reference.swap(_current);
+    _width = width;
+    _height = height;
+    _skippedFrames = 0;
+    return false;
+  }
+
+  void MotionGate::downsample(const uint8_t *data, int32_t width, int32_t height, int32_t channels, size_t stride)
+  {
+    // Average a 2x2 patch at the center of every cell, sensor noise mostly cancels out
+    _current.resize(static_cast<size_t>(kGridWidth * kGridHeight));
+    for (int32_t gy = 0; gy < kGridHeight; gy++)
+    {
+      const int32_t y = std::min(height - 2, (2 * gy + 1) * height / (2 * kGridHeight));
+      const uint8_t *row0 = data + static_cast<size_t>(y) * stride;
+      const uint8_t *row1 = row0 + stride;
+      for (int32_t gx = 0; gx < kGridWidth; gx++)
+      {
+        const int32_t x = std::min(width - 2, (2 * gx + 1) * width / (2 * kGridWidth));
+        uint32_t luma = 0;
+        for (const uint8_t *row : {row0, row1})
+        {
+          for (int32_t dx = 0; dx < 2; dx++)
+          {
+            const uint8_t *pixel = row + static_cast<size_t>(x + dx) * channels;
+            // BGR to luma with BT.601 weights, single channel images are already luma
+            luma += channels >= 3 ? (29u * pixel[0] + 150u * pixel[1] + 77u * pixel[2]) >> 8 : pixel[0];
+          }
+        }
+        _current[gy * kGridWidth + gx] = static_cast<uint8_t>(luma >> 2);
+      }
+    }
+  }
+
+  void MotionGate::reset()
+  {
+    _reference.clear();
+    _current.clear();
+    _width = 0;
+    _height = 0;
+    _score = 1.0f;
+    _skippedFrames = 0;
+  }
+
+} // namespace margelo::nitro::nitroinspireface
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace margelo::nitro::nitroinspireface
+{
+  /**
+   * Detects static scenes so a session can skip tracking on idle cameras.
+   *
+   * Every frame is reduced to a small luma thumbnail and compared with the
+   * thumbnail of the last frame that was tracked, using the mean absolute
+   * difference. Comparing with the last tracked frame rather than the previous
+   * frame keeps slow movement from slipping under the threshold. A frame is
+   * tracked anyway once too many frames in a row were skipped.
+   */
+  class MotionGate
+  {
+  public:
+    void configure(float threshold, uint32_t maxSkippedFrames);
+
+    // Score the frame, returns true when tracking can be skipped. Rows are stride bytes apart, 0 for packed rows
+    bool update(const uint8_t *data, int32_t width, int32_t height, int32_t channels, size_t stride = 0);
+    // Mean absolute luma difference between 0 and 1 of the latest frame
+    float score() const { return _score; }
+    void reset();
+
+  private:
+    void downsample(const uint8_t *data, int32_t width, int32_t height, int32_t channels, size_t stride);
+
+  private:
+    float _threshold = 0.01f;
+    uint32_t _maxSkippedFrames = 30;
+
+    std::vector<uint8_t> _reference;
+    std::vector<uint8_t> _current;
+    int32_t _width = 0;
+    int32_t _height = 0;
+    float _score = 1.0f;
+    uint32_t _skippedFrames = 0;
+  };
+
+} // namespace margelo::nitro::nitroinspireface
@@ -0,0 +1,129 @@
+#include "PipelineScheduler.hpp"
+#include <algorithm>
+#include <iterator>
+#include <unordered_set>
+
+namespace margelo::nitro::nitroinspireface
+{
+  namespace
+  {
+    // Weight of the newest run time in the cost average
+    constexpr double kCostSmoothing = 0.2;
+    // Staleness of a track no stage has run on yet, new faces go first
+    constexpr uint32_t kNeverRun = 1u << 20;
+  } // namespace
+
+  void PipelineScheduler::configure(double budget)
+  {
+    _budget = std::max(0.0, budget);
+  }
+
+  std::vector<PipelineScheduler::Stage> PipelineScheduler::stageOrder(const std::array<bool, StageCount> &enabled) const
+  {
+    std::vector<Stage> order;
+    for (size_t stage = 0; stage < StageCount; stage++)
+    {
+      if (enabled[stage])
+      {
+        order.push_back(static_cast<Stage>(stage));
+      }
+    }
+
+    // Recognition keeps its place, the optional stages are rotated by starvation
+    auto optional = std::find_if(order.begin(), order.end(), [](Stage stage)
+                                 { return stage != Recognition; });
+    std::stable_sort(optional, order.end(), [this](Stage a, Stage b)
+                     { return _stageStaleness[a] > _stageStaleness[b]; });
+    return order;
+  }
+
+  std::vector<size_t> PipelineScheduler::pickFaces(Stage stage, const std::vector<int32_t> &trackIds, double remaining)
+  {
+    std::vector<size_t> picks(trackIds.size());
+    for (size_t i = 0; i < picks.size(); i++)
+    {
+      picks[i] = i;
+    }
+    if (_budget <= 0.0)
+    {
+      return picks;
+    }
+
+    auto staleness = [&](size_t index)
+    {
+      auto found = _trackStaleness.find(trackIds[index]);
+      return found == _trackStaleness.end() ? kNeverRun : found->second[stage];
+    };
+    std::stable_sort(picks.begin(), picks.end(), [&](size_t a, size_t b)
+                     { return staleness(a) > staleness(b); });
+
+    // Recognition always gets the stalest face, only the optional stages can be skipped entirely
+    const size_t minimum = stage == Recognition ? 1 : 0;
+
+    // An unmeasured stage runs on a single face to learn its cost
+    if (!_measured[stage])
+    {
+      picks.resize(std::min<size_t>(picks.size(), remaining > 0.0 ? 1 : minimum));
+      return picks;
+    }
+
+    const size_t count = _cost[stage] > 0.0 ? static_cast<size_t>(std::max(0.0, remaining / _cost[stage])) : picks.size();
+    picks.resize(std::min(picks.size(), std::max(minimum, count)));
+    return picks;
+  }
+
+  void PipelineScheduler::record(Stage stage, const std::vector<int32_t> &trackIds, double elapsed)
+  {
+    if (trackIds.empty())
+    {
+      return;
+    }
+
+    const double perFace = elapsed / static_cast<double>(trackIds.size());
+    _cost[stage] = _measured[stage] ? _cost[stage] + kCostSmoothing * (perFace - _cost[stage]) : perFace;
+    _measured[stage] = true;
+    _stageStaleness[stage] = 0;
+    for (int32_t trackId : trackIds)
+    {
+      auto found = _trackStaleness.find(trackId);
+      if (found == _trackStaleness.end())
+      {
+        found = _trackStaleness.emplace(trackId, Staleness{}).first;
+        found->second.fill(kNeverRun);
+      }
+      found->second[stage] = 0;
+    }
+  }
+
+  void PipelineScheduler::endFrame(const std::vector<int32_t> &trackIds)
+  {
+    for (auto &staleness : _stageStaleness)
+    {
+      staleness++;
+    }
+
+    const std::unordered_set<int32_t> active(trackIds.begin(), trackIds.end());
+    for (auto it = _trackStaleness.begin(); it != _trackStaleness.end();)
+    {
+      if (active.count(it->first) == 0)
+      {
+        it = _trackStaleness.erase(it);
+        continue;
+      }
+      for (auto &staleness : it->second)
+      {
+        staleness = std::min(kNeverRun, staleness + 1);
+      }
+      it = std::next(it);
+    }
+  }
+
+  void PipelineScheduler::clear()
+  {
+    _cost.fill(0.0);
+    _measured.fill(false);
+    _stageStaleness.fill(0);
+    _trackStaleness.clear();
+  }
+
+} // namespace margelo::nitro::nitroinspireface
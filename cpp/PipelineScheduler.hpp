@@ -0,0 +1,60 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace margelo::nitro::nitroinspireface
+{
+  /**
+   * Decides which optional pipeline stages fit in the frame budget of a session.
+   *
+   * The cost of every stage is learned per face with an exponential moving
+   * average of its measured run time. Recognition is tried first and runs on
+   * at least one face every frame, even over budget. The other stages share
+   * what is left in priority order with the most starved stage first, so
+   * a stage skipped on one frame is tried early on the next. Inside a stage
+   * the faces that waited longest are picked first.
+   */
+  class PipelineScheduler
+  {
+  public:
+    // Same order as the PipelineStage enum, which is also the priority order
+    enum Stage : size_t
+    {
+      Recognition = 0,
+      Quality,
+      Liveness,
+      Mask,
+      Attribute,
+      StageCount
+    };
+
+    // Budget in milliseconds, 0 or less runs every stage on every face
+    void configure(double budget);
+    double budget() const { return _budget; }
+
+    // Enabled stages in the order they should be tried on this frame
+    std::vector<Stage> stageOrder(const std::array<bool, StageCount> &enabled) const;
+    // Indexes of the faces that fit in the remaining budget, most starved first
+    std::vector<size_t> pickFaces(Stage stage, const std::vector<int32_t> &trackIds, double remaining);
+    // Record a stage run on the given tracks
+    void record(Stage stage, const std::vector<int32_t> &trackIds, double elapsed);
+    // Age every stage that did not run and drop the tracks that ended
+    void endFrame(const std::vector<int32_t> &trackIds);
+    void clear();
+
+  private:
+    using Staleness = std::array<uint32_t, StageCount>;
+
+  private:
+    double _budget = 0.0;
+    std::array<double, StageCount> _cost{};
+    std::array<bool, StageCount> _measured{};
+    Staleness _stageStaleness{};
+    std::unordered_map<int32_t, Staleness> _trackStaleness;
+  };
+
+} // namespace margelo::nitro::nitroinspireface
@@ -0,0 +1,85 @@
+#include "ReidBuffer.hpp"
+#include "FeatureMath.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace margelo::nitro::nitroinspireface
+{
+  void ReidBuffer::configure(float threshold, double ttl, size_t capacity)
+  {
+    _threshold = threshold;
+    _ttl = std::chrono::milliseconds(static_cast<int64_t>(std::max(0.0, ttl)));
+    _capacity = std::max<size_t>(1, capacity);
+    while (_entries.size() > _capacity)
+    {
+      _entries.pop_front();
+    }
+  }
+
+  void ReidBuffer::push(int32_t trackId, int64_t id, float confidence, const float *feature, int32_t length, Clock::time_point now)
+  {
+    expire(now);
+    if (_entries.size() == _capacity)
+    {
+      _entries.pop_front();
+    }
+
+    Entry entry;
+    entry.trackId = trackId;
+    entry.id = id;
+    entry.confidence = confidence;
+    entry.feature.assign(feature, feature + length);
+    l2Normalize(entry.feature.data(), entry.feature.size());
+    entry.endedAt = now;
+    _entries.push_back(std::move(entry));
+  }
+
+  bool ReidBuffer::match(const float *feature, int32_t length, Clock::time_point now, Entry &entry)
+  {
+    expire(now);
+    const float norm = std::sqrt(dotProduct(feature, feature, length));
+    if (_entries.empty() || norm <= 0.0f)
+    {
+      return false;
+    }
+
+    auto best = _entries.end();
+    float bestSimilarity = _threshold;
+    for (auto it = _entries.begin(); it != _entries.end(); ++it)
+    {
+      if (it->feature.size() != static_cast<size_t>(length))
+      {
+        continue;
+      }
+      const float similarity = dotProduct(feature, it->feature.data(), length) / norm;
+      if (similarity >= bestSimilarity)
+      {
+        bestSimilarity = similarity;
+        best = it;
+      }
+    }
+
+    if (best == _entries.end())
+    {
+      return false;
+    }
+    entry = std::move(*best);
+    _entries.erase(best);
+    return true;
+  }
+
+  void ReidBuffer::expire(Clock::time_point now)
+  {
+    // Entries are pushed in order, so expired ones are always at the front
+    while (!_entries.empty() && now - _entries.front().endedAt > _ttl)
+    {
+      _entries.pop_front();
+    }
+  }
+
+  void ReidBuffer::clear()
+  {
+    _entries.clear();
+  }
+
+} // namespace margelo::nitro::nitroinspireface
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+namespace margelo::nitro::nitroinspireface
+{
+  /**
+   * Short-lived memory of tracks that just ended.
+   *
+   * The tracker hands out a new trackId when a face is lost for a few frames,
+   * e.g. behind an occlusion. New tracks are compared against this handful of
+   * recently ended tracks first, so they can take over the trackId and the
+   * identity of the person instead of going through a FeatureHub search.
+   */
+  class ReidBuffer
+  {
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Entry
+    {
+      int32_t trackId = -1;
+      int64_t id = -1;
+      float confidence = 0.0f;
+      std::vector<float> feature;
+      Clock::time_point endedAt;
+    };
+
+    void configure(float threshold, double ttl, size_t capacity);
+
+    // feature does not need to be normalized
+    void push(int32_t trackId, int64_t id, float confidence, const float *feature, int32_t length, Clock::time_point now);
+    // Removes and returns the most similar entry above the threshold
+    bool match(const float *feature, int32_t length, Clock::time_point now, Entry &entry);
+
+    bool empty() const { return _entries.empty(); }
+    void clear();
+
+  private:
+    void expire(Clock::time_point now);
+
+  private:
+    float _threshold = 0.48f;
+    std::chrono::milliseconds _ttl{3000};
+    size_t _capacity = 16;
+    std::deque<Entry> _entries;
+  };
+
+} // namespace margelo::nitro::nitroinspireface
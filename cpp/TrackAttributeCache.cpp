@@ -0,0 +1,56 @@
+#include "TrackAttributeCache.hpp"
+#include <algorithm>
+#include <iterator>
+#include <unordered_set>
+
+namespace margelo::nitro::nitroinspireface
+{
+  void TrackAttributeCache::configure(double ttl)
+  {
+    _ttl = std::chrono::milliseconds(static_cast<int64_t>(std::max(0.0, ttl)));
+  }
+
+  const TrackAttributeCache::Entry *TrackAttributeCache::lookup(int32_t trackId, int32_t options, Clock::time_point now) const
+  {
+    auto it = _entries.find(trackId);
+    if (it == _entries.end())
+    {
+      return nullptr;
+    }
+
+    const Entry &entry = it->second;
+    if ((entry.options & options) != options || now - entry.refreshedAt > _ttl)
+    {
+      return nullptr;
+    }
+    return &entry;
+  }
+
+  TrackAttributeCache::Entry &TrackAttributeCache::store(int32_t trackId, int32_t options, Clock::time_point now)
+  {
+    Entry &entry = _entries[trackId];
+    entry = Entry{};
+    entry.options = options;
+    entry.refreshedAt = now;
+    return entry;
+  }
+
+  void TrackAttributeCache::retain(const std::vector<int32_t> &trackIds)
+  {
+    if (_entries.empty())
+    {
+      return;
+    }
+    const std::unordered_set<int32_t> alive(trackIds.begin(), trackIds.end());
+    for (auto it = _entries.begin(); it != _entries.end();)
+    {
+      it = alive.count(it->first) ? std::next(it) : _entries.erase(it);
+    }
+  }
+
+  void TrackAttributeCache::clear()
+  {
+    _entries.clear();
+  }
+
+} // namespace margelo::nitro::nitroinspireface
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace margelo::nitro::nitroinspireface
+{
+  /**
+   * Pipeline results of the tracks a session currently follows, keyed by trackId.
+   *
+   * Age, gender and mask state rarely change while a face stays tracked, so
+   * the pipeline only has to run on new tracks and on entries older than the
+   * TTL. Entries are evicted as soon as their track is no longer part of the
+   * tracking output.
+   */
+  class TrackAttributeCache
+  {
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Entry
+    {
+      // HF_ENABLE_* flags of the stages held by the entry
+      int32_t options = 0;
+      float quality = 0.0f;
+      float liveness = 0.0f;
+      float mask = 0.0f;
+      int32_t ageBracket = 0;
+      int32_t gender = 0;
+      int32_t race = 0;
+      Clock::time_point refreshedAt;
+    };
+
+    void configure(double ttl);
+
+    // Cached entry of the track when it is fresh and holds every requested stage, or nullptr
+    const Entry *lookup(int32_t trackId, int32_t options, Clock::time_point now) const;
+    // Reset the entry of the track, the caller fills in the stages given by options
+    Entry &store(int32_t trackId, int32_t options, Clock::time_point now);
+
+    // Drop every track not in the latest tracking output
+    void retain(const std::vector<int32_t> &trackIds);
+    void clear();
+
+  private:
+    std::chrono::milliseconds _ttl{5000};
+    std::unordered_map<int32_t, Entry> _entries;
+  };
+
+} // namespace margelo::nitro::nitroinspireface
@@ -0,0 +1,69 @@
+#include "TrackFeatureCache.hpp"
+#include <algorithm>
+#include <iterator>
+#include <unordered_set>
+
+namespace margelo::nitro::nitroinspireface
+{
+  void TrackFeatureCache::configure(double ttl, float sizeGrowth, float poseImprovement)
+  {
+    _ttl = std::chrono::milliseconds(static_cast<int64_t>(std::max(0.0, ttl)));
+    _sizeGrowth = std::max(1.0f, sizeGrowth);
+    _poseImprovement = std::max(0.0f, poseImprovement);
+  }
+
+  const std::vector<float> *TrackFeatureCache::lookup(int32_t trackId, float faceArea, float poseError, Clock::time_point now) const
+  {
+    auto it = _entries.find(trackId);
+    if (it == _entries.end())
+    {
+      return nullptr;
+    }
+
+    const Entry &entry = it->second;
+    if (now - entry.extractedAt > _ttl)
+    {
+      return nullptr;
+    }
+    // A closer or more frontal view gives a better feature than the cached one
+    if (faceArea > entry.faceArea * _sizeGrowth || poseError < entry.poseError - _poseImprovement)
+    {
+      return nullptr;
+    }
+    return &entry.feature;
+  }
+
+  const std::vector<float> *TrackFeatureCache::peek(int32_t trackId) const
+  {
+    auto it = _entries.find(trackId);
+    return it == _entries.end() ? nullptr : &it->second.feature;
+  }
+
+  void TrackFeatureCache::store(int32_t trackId, const float *feature, int32_t length, float faceArea, float poseError, Clock::time_point now)
+  {
+    Entry &entry = _entries[trackId];
+    entry.feature.assign(feature, feature + length);
+    entry.faceArea = faceArea;
+    entry.poseError = poseError;
+    entry.extractedAt = now;
+  }
+
+  void TrackFeatureCache::retain(const std::vector<int32_t> &trackIds)
+  {
+    if (_entries.empty())
+    {
+      return;
+    }
+    const std::unordered_set<int32_t> alive(trackIds.begin(), trackIds.end());
+    for (auto it = _entries.begin(); it != _entries.end();)
+    {
+      it = alive.count(it->first) ? std::next(it) : _entries.erase(it);
+    }
+  }
+
+  void TrackFeatureCache::clear()
+  {
+    _entries.clear();
+  }
+
+} // namespace margelo::nitro::nitroinspireface
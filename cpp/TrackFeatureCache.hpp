@@ -0,0 +1,52 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace margelo::nitro::nitroinspireface
+{
+  /**
+   * Face features of the tracks a session currently follows, keyed by trackId.
+   *
+   * In tracking modes a person keeps the same trackId for many frames, so the
+   * feature extracted on the first frame can be reused. A cached feature is
+   * only replaced when the face grew enough, the head turned closer to frontal
+   * or the entry got too old. Entries are evicted as soon as their track is no
+   * longer part of the tracking output.
+   */
+  class TrackFeatureCache
+  {
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    void configure(double ttl, float sizeGrowth, float poseImprovement);
+
+    // Cached feature of the track, or nullptr when it must be extracted again
+    const std::vector<float> *lookup(int32_t trackId, float faceArea, float poseError, Clock::time_point now) const;
+    // Cached feature of the track regardless of its age, or nullptr
+    const std::vector<float> *peek(int32_t trackId) const;
+    void store(int32_t trackId, const float *feature, int32_t length, float faceArea, float poseError, Clock::time_point now);
+
+    // Drop every track not in the latest tracking output
+    void retain(const std::vector<int32_t> &trackIds);
+    void clear();
+
+  private:
+    struct Entry
+    {
+      std::vector<float> feature;
+      float faceArea;
+      float poseError;
+      Clock::time_point extractedAt;
+    };
+
+  private:
+    std::chrono::milliseconds _ttl{2000};
+    float _sizeGrowth = 1.25f;
+    float _poseImprovement = 10.0f;
+    std::unordered_map<int32_t, Entry> _entries;
+  };
+
+} // namespace margelo::nitro::nitroinspireface
@@ -0,0 +1,104 @@
+#include "TrackFeatureFusion.hpp"
+#include "FeatureMath.hpp"
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <unordered_set>
+
+namespace margelo::nitro::nitroinspireface
+{
+  void TrackFeatureFusion::configure(uint32_t interval, float minWeight, double retainFor)
+  {
+    _interval = std::max<uint32_t>(1, interval);
+    _minWeight = std::max(0.0f, minWeight);
+    _retainFor = std::chrono::milliseconds(static_cast<int64_t>(std::max(0.0, retainFor)));
+  }
+
+  bool TrackFeatureFusion::due(int32_t trackId)
+  {
+    Track &track = _tracks[trackId];
+    return track.frames++ % _interval == 0;
+  }
+
+  void TrackFeatureFusion::add(int32_t trackId, const float *feature, int32_t length, float weight)
+  {
+    if (weight <= 0.0f || weight < _minWeight)
+    {
+      return;
+    }
+
+    Track &track = _tracks[trackId];
+    if (track.sum.size() != static_cast<size_t>(length))
+    {
+      track.sum.assign(length, 0.0f);
+      track.weight = 0.0f;
+    }
+
+    // Normalize first so every frame counts by its weight, not by its norm
+    const float norm = std::sqrt(dotProduct(feature, feature, length));
+    if (norm <= 0.0f)
+    {
+      return;
+    }
+    const float scale = weight / norm;
+    for (int32_t i = 0; i < length; i++)
+    {
+      track.sum[i] += feature[i] * scale;
+    }
+    track.weight += weight;
+  }
+
+  bool TrackFeatureFusion::get(int32_t trackId, std::vector<float> &fused) const
+  {
+    auto it = _tracks.find(trackId);
+    if (it == _tracks.end() || it->second.weight <= 0.0f)
+    {
+      return false;
+    }
+    fused = it->second.sum;
+    l2Normalize(fused.data(), fused.size());
+    return true;
+  }
+
+  void TrackFeatureFusion::retain(const std::vector<int32_t> &trackIds, Clock::time_point now)
+  {
+    if (_tracks.empty())
+    {
+      return;
+    }
+    const std::unordered_set<int32_t> alive(trackIds.begin(), trackIds.end());
+    for (auto it = _tracks.begin(); it != _tracks.end();)
+    {
+      Track &track = it->second;
+      if (alive.count(it->first))
+      {
+        track.ended = false;
+      }
+      else if (!track.ended)
+      {
+        track.ended = true;
+        track.endedAt = now;
+      }
+      it = track.ended && now - track.endedAt > _retainFor ? _tracks.erase(it) : std::next(it);
+    }
+  }
+
+  bool TrackFeatureFusion::rename(int32_t from, int32_t to)
+  {
+    auto it = _tracks.find(from);
+    if (it == _tracks.end() || from == to)
+    {
+      return it != _tracks.end();
+    }
+    Track track = std::move(it->second);
+    _tracks.erase(it);
+    _tracks[to] = std::move(track);
+    return true;
+  }
+
+  void TrackFeatureFusion::clear()
+  {
+    _tracks.clear();
+  }
+
+} // namespace margelo::nitro::nitroinspireface
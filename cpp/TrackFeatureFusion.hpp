@@ -0,0 +1,55 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace margelo::nitro::nitroinspireface
+{
+  /**
+   * Quality-weighted running mean of the face features of every active track.
+   *
+   * Features are L2-normalized before they are accumulated and the mean is
+   * normalized again when read, so the fused feature compares like any single
+   * extracted feature while averaging out per-frame noise. Tracks that ended
+   * stay readable for a grace period, so their fused feature can still be
+   * fetched on and shortly after the frame they ended on.
+   */
+  class TrackFeatureFusion
+  {
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    void configure(uint32_t interval, float minWeight, double retainFor);
+
+    // Whether the track is due for an extraction on this frame, counts the frame
+    bool due(int32_t trackId);
+    void add(int32_t trackId, const float *feature, int32_t length, float weight);
+
+    bool get(int32_t trackId, std::vector<float> &fused) const;
+
+    // End every track not in the latest tracking output, drop the ones ended longer than the grace period ago
+    void retain(const std::vector<int32_t> &trackIds, Clock::time_point now);
+    // Move the state of a track under another trackId, replacing what was stored there. False when there is none
+    bool rename(int32_t from, int32_t to);
+    void clear();
+
+  private:
+    struct Track
+    {
+      std::vector<float> sum;
+      float weight = 0.0f;
+      uint32_t frames = 0;
+      bool ended = false;
+      Clock::time_point endedAt;
+    };
+
+  private:
+    uint32_t _interval = 1;
+    float _minWeight = 0.0f;
+    std::chrono::milliseconds _retainFor{1000};
+    std::unordered_map<int32_t, Track> _tracks;
+  };
+
+} // namespace margelo::nitro::nitroinspireface
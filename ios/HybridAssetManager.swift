@@ -1,4 +1,7 @@
 import Foundation
+import ImageIO
+import CoreGraphics
+import Accelerate
 import NitroModules
 
 public class HybridAssetManager: HybridAssetManagerSpec {
@@ -53,4 +56,119 @@ public class HybridAssetManager: HybridAssetManagerSpec {
             return false
         }
     }
+
+    public func decodeImage(buffer: ArrayBufferHolder, maxSize: Double?) throws -> DecodedImage {
+        let data = Data(bytesNoCopy: buffer.data, count: buffer.size, deallocator: .none)
+        guard let source = CGImageSourceCreateWithData(data as CFData, nil) else {
+            throw NSError(domain: "NitroInspireFaceUtils",
+                          code: 2,
+                          userInfo: [NSLocalizedDescriptionKey: "Unsupported or corrupt image data"])
+        }
+
+        // Thumbnails of JPEGs are decoded at a reduced DCT scale, the full image is never expanded
+        let image: CGImage?
+        if let maxSize = maxSize, maxSize > 0 {
+            let options: [CFString: Any] = [
+                kCGImageSourceCreateThumbnailFromImageAlways: true,
+                kCGImageSourceThumbnailMaxPixelSize: maxSize,
+                kCGImageSourceShouldCacheImmediately: true,
+            ]
+            image = CGImageSourceCreateThumbnailAtIndex(source, 0, options as CFDictionary)
+        } else {
+            image = CGImageSourceCreateImageAtIndex(source, 0, [kCGImageSourceShouldCacheImmediately: true] as CFDictionary)
+        }
+        guard let image = image else {
+            throw NSError(domain: "NitroInspireFaceUtils",
+                          code: 3,
+                          userInfo: [NSLocalizedDescriptionKey: "Failed to decode image data"])
+        }
+
+        let width = image.width
+        let height = image.height
+        let hasAlpha: Bool
+        switch image.alphaInfo {
+        case .none, .noneSkipFirst, .noneSkipLast:
+            hasAlpha = false
+        default:
+            hasAlpha = true
+        }
+
+        // Opaque images skip alpha entirely, CoreGraphics can only draw alpha premultiplied
+        let pixels = ArrayBufferHolder.allocate(size: width * height * 4)
+        let alphaInfo: CGImageAlphaInfo = hasAlpha ? .premultipliedLast : .noneSkipLast
+        guard let context = CGContext(data: pixels.data,
+                                      width: width,
+                                      height: height,
+                                      bitsPerComponent: 8,
+                                      bytesPerRow: width * 4,
+                                      space: CGColorSpaceCreateDeviceRGB(),
+                                      bitmapInfo: alphaInfo.rawValue) else {
+            throw NSError(domain: "NitroInspireFaceUtils",
+                          code: 4,
+                          userInfo: [NSLocalizedDescriptionKey: "Failed to create bitmap context"])
+        }
+        context.draw(image, in: CGRect(x: 0, y: 0, width: width, height: height))
+
+        if hasAlpha {
+            // Straight alpha, like Android decodes with inPremultiplied = false
+            var buffer = vImage_Buffer(data: pixels.data,
+                                       height: vImagePixelCount(height),
+                                       width: vImagePixelCount(width),
+                                       rowBytes: width * 4)
+            vImageUnpremultiplyData_RGBA8888(&buffer, &buffer, vImage_Flags(kvImageNoFlags))
+        } else {
+            // The skipped byte is left undefined, make it opaque
+            for offset in stride(from: 3, to: width * height * 4, by: 4) {
+                pixels.data[offset] = 0xFF
+            }
+        }
+        return DecodedImage(data: pixels, width: Double(width), height: Double(height))
+    }
+
+    public func encodeImage(data: ArrayBufferHolder, width: Double, height: Double, format: ImageEncoding, quality: Double) throws -> ArrayBufferHolder {
+        let width = Int(width)
+        let height = Int(height)
+        guard width > 0, height > 0, data.size == width * height * 4,
+              let provider = CGDataProvider(data: Data(bytesNoCopy: data.data, count: data.size, deallocator: .none) as CFData),
+              let image = CGImage(width: width,
+                                  height: height,
+                                  bitsPerComponent: 8,
+                                  bitsPerPixel: 32,
+                                  bytesPerRow: width * 4,
+                                  space: CGColorSpaceCreateDeviceRGB(),
+                                  bitmapInfo: CGBitmapInfo(rawValue: CGImageAlphaInfo.last.rawValue),
+                                  provider: provider,
+                                  decode: nil,
+                                  shouldInterpolate: false,
+                                  intent: .defaultIntent) else {
+            throw NSError(domain: "NitroInspireFaceUtils",
+                          code: 5,
+                          userInfo: [NSLocalizedDescriptionKey: "Invalid image data"])
+        }
+
+        let type: CFString
+        switch format {
+        case .jpeg:
+            type = "public.jpeg" as CFString
+        case .png:
+            type = "public.png" as CFString
+        }
+        let output = NSMutableData()
+        guard let destination = CGImageDestinationCreateWithData(output as CFMutableData, type, 1, nil) else {
+            throw NSError(domain: "NitroInspireFaceUtils",
+                          code: 6,
+                          userInfo: [NSLocalizedDescriptionKey: "Unsupported image format"])
+        }
+        let options: [CFString: Any] = [kCGImageDestinationLossyCompressionQuality: quality / 100.0]
+        CGImageDestinationAddImage(destination, image, options as CFDictionary)
+        guard CGImageDestinationFinalize(destination) else {
+            throw NSError(domain: "NitroInspireFaceUtils",
+                          code: 7,
+                          userInfo: [NSLocalizedDescriptionKey: "Failed to encode image data"])
+        }
+
+        let encoded = ArrayBufferHolder.allocate(size: output.length)
+        memcpy(encoded.data, output.bytes, output.length)
+        return encoded
+    }
 }
@@ -1,4 +1,6 @@
 import type { HybridObject } from 'react-native-nitro-modules';
+import type { ImageEncoding } from './enums';
+import type { DecodedImage } from './types';
 
 /**
  * Interface for managing assets in the application.
@@ -26,4 +28,29 @@ export interface AssetManager
    * @returns Boolean indicating success or failure of the copy operation
    */
   copyAssetToFile(assetPath: string, filePath: string): boolean;
+
+  /**
+   * Decode JPEG or PNG bytes with the platform decoder.
+   * @param buffer Encoded image
+   * @param maxSize Optional longest side in pixels, large JPEGs are scaled down while decoding
+   * @returns RGBA pixels of the image, with straight (not premultiplied) alpha
+   */
+  decodeImage(buffer: ArrayBuffer, maxSize?: number): DecodedImage;
+
+  /**
+   * Encode RGBA pixels with the platform encoder.
+   * @param data RGBA pixels, width * height * 4 bytes
+   * @param width Width of the image in pixels
+   * @param height Height of the image in pixels
+   * @param format JPEG or PNG
+   * @param quality JPEG quality from 0 to 100, ignored for PNG
+   * @returns Encoded image
+   */
+  encodeImage(
+    data: ArrayBuffer,
+    width: number,
+    height: number,
+    format: ImageEncoding,
+    quality: number
+  ): ArrayBuffer;
 }
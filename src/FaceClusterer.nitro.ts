@@ -0,0 +1,53 @@
+import type { HybridObject } from 'react-native-nitro-modules';
+import type { FaceCluster } from './types';
+
+/**
+ * Groups face features by person without enrollment.
+ * Faces are linked to their nearest neighbors above a similarity threshold and
+ * the resulting graph is partitioned with Chinese Whispers.
+ */
+export interface FaceClusterer
+  extends HybridObject<{ ios: 'c++'; android: 'c++' }> {
+  /** Number of faces added to the clusterer */
+  readonly faceCount: number;
+  /** Number of clusters, 0 until `cluster` has run */
+  readonly clusterCount: number;
+
+  /**
+   * Add a face feature.
+   * Once `cluster` has run, the face is assigned to a cluster right away.
+   * @param feature Face feature extracted by `Session.extractFaceFeature`
+   * @returns ID of the face inside the clusterer
+   */
+  addFace(feature: ArrayBuffer): number;
+
+  /**
+   * Add several face features.
+   * @param features Face features extracted by `Session.extractFaceFeature`
+   * @returns IDs of the faces inside the clusterer
+   */
+  addFaces(features: ArrayBuffer[]): number[];
+
+  /**
+   * Cluster all faces from scratch.
+   * @param workerCount Number of threads building the neighbor graph
+   */
+  cluster(workerCount: number): Promise<FaceCluster[]>;
+
+  /**
+   * Get the current clusters, including faces absorbed since the last `cluster` call.
+   */
+  getClusters(): FaceCluster[];
+
+  /**
+   * Get the cluster of a face.
+   * @param faceId ID returned by `addFace`
+   * @returns Cluster ID, or -1 before `cluster` has run
+   */
+  getClusterId(faceId: number): number;
+
+  /**
+   * Remove all faces and clusters.
+   */
+  clear(): void;
+}
@@ -1,5 +1,14 @@
 import type { HybridObject } from 'react-native-nitro-modules';
-import type { Color, FaceRect, Point2f, Point2i } from './types';
+import type { ImageEncoding, ImageFormat, Interpolation } from './enums';
+import type {
+  Color,
+  FaceData,
+  FaceRect,
+  ImageTransform,
+  OverlayStyle,
+  Point2f,
+  Point2i,
+} from './types';
 
 /**
  * Interface for handling bitmap image operations.
@@ -13,7 +22,10 @@ export interface ImageBitmap
   readonly height: number;
   /** Number of color channels in the image */
   readonly channels: number;
-  /** Raw image data as ArrayBuffer */
+  /**
+   * Raw image data as ArrayBuffer.
+   * The buffer is a view of the bitmap memory, not a copy. It keeps the memory alive after the bitmap is disposed and reflects later draw calls.
+   */
   readonly data: ArrayBuffer;
 
   /**
@@ -51,4 +63,60 @@ export interface ImageBitmap
     color: Color,
     thickness: number
   ): void;
+
+  /**
+   * Draw the rectangles, track IDs and landmarks of many faces in a single call.
+   * @param faces Faces to draw, e.g. the result of `Session.executeFaceTrack`
+   * @param style Colors and sizes to draw with
+   * @param landmarks Optional landmark points of all faces, packed as float32 x, y pairs
+   */
+  drawFaces(faces: FaceData[], style: OverlayStyle, landmarks?: ArrayBuffer): void;
+
+  /**
+   * Draw many points in a single call, each as a filled square.
+   * @param points Points packed as float32 x, y pairs, e.g. the buffer of a Float32Array
+   * @param color RGB color for drawing
+   * @param size Optional side of the squares in pixels. Default to 2
+   */
+  drawPoints(points: ArrayBuffer, color: Color, size?: number): void;
+
+  /**
+   * Copy a region of the image into a new bitmap.
+   * @param rect Region to copy, clamped to the image
+   */
+  crop(rect: FaceRect): ImageBitmap;
+
+  /**
+   * Resize the image into a new bitmap.
+   * @param width Width of the result in pixels
+   * @param height Height of the result in pixels
+   * @param interpolation Resampling to use, AREA when shrinking and BILINEAR otherwise by default
+   */
+  resize(
+    width: number,
+    height: number,
+    interpolation?: Interpolation
+  ): ImageBitmap;
+
+  /**
+   * Convert the image to another channel layout in a new bitmap.
+   * 3 channel images are read as BGR, 4 channel images as BGRA.
+   * @param format RGB, BGR, RGBA or BGRA
+   */
+  convert(format: ImageFormat): ImageBitmap;
+
+  /**
+   * Crop, rotate, resize and convert the image into a new bitmap in a single pass.
+   * @param transform Operations to apply
+   */
+  transform(transform: ImageTransform): ImageBitmap;
+
+  /**
+   * Compress the image to JPEG or PNG bytes on a worker thread, without touching the filesystem.
+   * 3 channel images are read as BGR, 4 channel images as BGRA.
+   * @param format JPEG or PNG
+   * @param quality Optional JPEG quality from 0 to 100, ignored for PNG. Default to 90
+   * @returns Encoded image
+   */
+  encode(format: ImageEncoding, quality?: number): Promise<ArrayBuffer>;
 }
@@ -1,6 +1,7 @@
 import type { HybridObject } from 'react-native-nitro-modules';
-import type { CameraRotation, ImageFormat } from './enums';
+import type { CameraRotation, ImageEncoding, ImageFormat } from './enums';
 import type { ImageBitmap } from './ImageBitmap.nitro';
+import type { FaceRect, ImageTransform } from './types';
 
 /**
  * Interface for handling image stream operations.
@@ -8,6 +9,9 @@ import type { ImageBitmap } from './ImageBitmap.nitro';
  */
 export interface ImageStream
   extends HybridObject<{ ios: 'c++'; android: 'c++' }> {
+  /** Region of interest the session works on, in frame coordinates */
+  readonly roi?: FaceRect;
+
   /**
    * Write the image stream to a file.
    * @param filePath Path where the image will be saved
@@ -32,4 +36,27 @@ export interface ImageStream
    * @param scale Scale factor to apply
    */
   createImageBitmap(isRotate?: boolean, scale?: number): ImageBitmap;
+
+  /**
+   * Restrict sessions to a region of the frame.
+   * Face rects and landmarks are still reported in frame coordinates.
+   * @param roi Region of interest in frame coordinates, or nothing to use the whole frame
+   */
+  setRoi(roi?: FaceRect): void;
+
+  /**
+   * Crop, rotate, resize and convert the source bitmap into a new bitmap in a single pass.
+   * Unlike `createImageBitmap`, the full frame is never copied. Only image streams created from a bitmap are supported.
+   * @param transform Operations to apply, the rotation defaults to the stream rotation
+   */
+  transform(transform: ImageTransform): ImageBitmap;
+
+  /**
+   * Compress the frame to JPEG or PNG bytes on a worker thread, turned upright by the stream rotation.
+   * Replaces `writeImageToFile` followed by reading the file back.
+   * @param format JPEG or PNG
+   * @param quality Optional JPEG quality from 0 to 100, ignored for PNG. Default to 90
+   * @returns Encoded image
+   */
+  encode(format: ImageEncoding, quality?: number): Promise<ArrayBuffer>;
 }
@@ -4,16 +4,24 @@ import type {
   CameraRotation,
   DetectMode,
 } from './enums';
+import type { FaceClusterer } from './FaceClusterer.nitro';
 import type { ImageBitmap } from './ImageBitmap.nitro';
 import type { ImageStream } from './ImageStream.nitro';
 import type { Session } from './Session.nitro';
+import type { TiledDetector } from './TiledDetector.nitro';
+import type { VisitorCounter } from './VisitorCounter.nitro';
 import type {
+  FaceClustererConfig,
   FaceFeatureIdentity,
   FeatureHubConfiguration,
+  FeatureMigrationResult,
+  GalleryAuditReport,
   Point2f,
   SearchTopKResult,
   SessionCustomParameter,
   SimilarityConverterConfig,
+  TiledDetectorConfig,
+  VisitorCounterConfig,
 } from './types';
 
 /**
@@ -30,6 +38,8 @@ export interface InspireFace
   readonly faceDenseLandmarkLength: number;
   /** Length of basic face tokens */
   readonly faceBasicTokenLength: number;
+  /** Model pack that produces newly extracted features (the file name of the pack passed to `launch`/`reload`) */
+  readonly modelTag: string;
 
   /**
    * Initialize the SDK with resources.
@@ -81,18 +91,39 @@ export interface InspireFace
     trackByDetectModeFPS: number
   ): Session;
 
+  /**
+   * Create a clusterer that groups face features by person.
+   * @param config Clustering settings
+   */
+  createFaceClusterer(config: FaceClustererConfig): FaceClusterer;
+
+  /**
+   * Create a counter of distinct people seen by a camera.
+   * @param config Counting settings
+   */
+  createVisitorCounter(config: VisitorCounterConfig): VisitorCounter;
+
+  /**
+   * Create a detector that finds small faces in large frames tile by tile.
+   * @param config Tiling settings
+   */
+  createTiledDetector(config: TiledDetectorConfig): TiledDetector;
+
   /**
    * Create an image bitmap from a buffer.
    * @param buffer Raw image data
    * @param width Image width
    * @param height Image height
    * @param channels Number of color channels
+   * @param adopt Reference the buffer instead of copying it, it is only copied on the first draw call or read of `data`.
+   * The buffer must not be changed or transferred while the bitmap or its image streams are alive
    */
   createImageBitmapFromBuffer(
     buffer: ArrayBuffer,
     width: number,
     height: number,
-    channels: number
+    channels: number,
+    adopt?: boolean
   ): ImageBitmap;
 
   /**
@@ -105,6 +136,30 @@ export interface InspireFace
     filePath: string
   ): ImageBitmap;
 
+  /**
+   * Create an image bitmap from JPEG or PNG bytes, without writing them to a file.
+   * @param buffer Encoded image
+   * @param channels Number of color channels, 3 for BGR or 4 for BGRA
+   * @param maxSize Optional longest side of the bitmap in pixels, large JPEGs are scaled down while decoding
+   */
+  createImageBitmapFromEncoded(
+    buffer: ArrayBuffer,
+    channels: number,
+    maxSize?: number
+  ): ImageBitmap;
+
+  /**
+   * Create an image bitmap from JPEG or PNG bytes on a worker thread.
+   * @param buffer Encoded image
+   * @param channels Number of color channels, 3 for BGR or 4 for BGRA
+   * @param maxSize Optional longest side of the bitmap in pixels, large JPEGs are scaled down while decoding
+   */
+  createImageBitmapFromEncodedAsync(
+    buffer: ArrayBuffer,
+    channels: number,
+    maxSize?: number
+  ): Promise<ImageBitmap>;
+
   /**
    * Create an image stream from a bitmap.
    * @param bitmap Source bitmap image
@@ -119,33 +174,61 @@ export interface InspireFace
    * Get dense facial landmarks from a face token.
    * @param token Face token data
    * @param num Optional number of landmarks to retrieve
+   * @param imageStream Optional stream the face was tracked on, its region of interest is mapped back to the frame
    */
   getFaceDenseLandmarkFromFaceToken(
     token: ArrayBuffer,
-    num?: number
+    num?: number,
+    imageStream?: ImageStream
   ): Point2f[];
 
   /**
    * Get five key facial points from a face token.
    * @param token Face token data
    * @param num Optional number of points to retrieve
+   * @param imageStream Optional stream the face was tracked on, its region of interest is mapped back to the frame
    */
   getFaceFiveKeyPointsFromFaceToken(
     token: ArrayBuffer,
-    num?: number
+    num?: number,
+    imageStream?: ImageStream
   ): Point2f[];
 
+  /**
+   * Get the dense facial landmarks of many faces in a single call.
+   * @param tokens Face token data of every face
+   * @param imageStream Optional stream the faces were tracked on, its region of interest is mapped back to the frame
+   * @returns Landmarks of all faces one after the other, `faceDenseLandmarkLength` float32 x, y pairs per face
+   */
+  getFaceDenseLandmarksFromFaceTokens(
+    tokens: ArrayBuffer[],
+    imageStream?: ImageStream
+  ): ArrayBuffer;
+
+  /**
+   * Get the five key facial points of many faces in a single call.
+   * @param tokens Face token data of every face
+   * @param imageStream Optional stream the faces were tracked on, its region of interest is mapped back to the frame
+   * @returns Key points of all faces one after the other, 5 float32 x, y pairs per face
+   */
+  getFaceFiveKeyPointsFromFaceTokens(
+    tokens: ArrayBuffer[],
+    imageStream?: ImageStream
+  ): ArrayBuffer;
+
   /**
    * Insert a face feature into the database.
    * @param feature Face feature identity to insert
+   * @param crop Optional aligned face image the feature was extracted from, kept so `featureHubMigrate` can re-extract it
    */
-  featureHubFaceInsert(feature: FaceFeatureIdentity): number;
+  featureHubFaceInsert(feature: FaceFeatureIdentity, crop?: ImageBitmap): number;
 
   /**
    * Update a face feature in the database.
    * @param feature Face feature identity to update
+   * @param crop Optional aligned face image the feature was extracted from, replaces the stored crop
    */
-  featureHubFaceUpdate(feature: FaceFeatureIdentity): boolean;
+  featureHubFaceUpdate(feature: FaceFeatureIdentity, crop?: ImageBitmap): boolean;
 
   /**
    * Remove a face feature from the database.
@@ -175,6 +258,59 @@ export interface InspireFace
     topK: number
   ): SearchTopKResult[];
 
+  /**
+   * Get the model pack that produced a stored face feature.
+   * @param id ID of the face feature
+   */
+  featureHubGetFaceModelTag(id: number): string | null;
+
+  /**
+   * Get the IDs of face features produced by a model pack other than the current one, or stored without a model pack tag.
+   */
+  featureHubGetStaleIds(): number[];
+
+  /**
+   * Store the aligned face crop of a face feature so it can be re-extracted after a model change.
+   * Throws if no face feature with this ID exists.
+   * @param id ID of the face feature
+   * @param bitmap Aligned face image, see `Session.getFaceAlignmentImage`
+   */
+  featureHubSetFaceCrop(id: number, bitmap: ImageBitmap): void;
+
+  /**
+   * Re-extract all stale face features from their stored crops with the current model pack.
+   * Crops must be registered beforehand, at insert or with `featureHubSetFaceCrop`. IDs without one are skipped and keep their stale feature.
+   * Progress is checkpointed, so a cancelled or interrupted migration resumes on the next call.
+   * @param workerCount Number of sessions extracting in parallel
+   * @param onProgress Optional callback receiving the number of completed and total features
+   */
+  featureHubMigrate(
+    workerCount: number,
+    onProgress?: (completed: number, total: number) => void
+  ): Promise<FeatureMigrationResult>;
+
+  /**
+   * Cancel a running migration, keeping its checkpoint.
+   */
+  featureHubCancelMigration(): void;
+
+  /**
+   * Compare every pair of stored face features to find duplicate enrollments.
+   * @param threshold Similarity at or above which a pair is reported
+   * @param workerCount Number of threads scanning in parallel
+   * @param onProgress Optional callback receiving the number of completed and total blocks
+   */
+  featureHubAudit(
+    threshold: number,
+    workerCount: number,
+    onProgress?: (completed: number, total: number) => void
+  ): Promise<GalleryAuditReport>;
+
+  /**
+   * Cancel a running audit.
+   */
+  featureHubCancelAudit(): void;
+
   /**
    * Get the total count of face features in the database.
    */
@@ -7,6 +7,21 @@ import type {
   SessionCustomParameter,
   FaceAttributeResult,
   FaceInteractionsAction,
+  FeatureCacheConfig,
+  BestShot,
+  BestShotConfig,
+  TrackFusionConfig,
+  IdentifyOptions,
+  IdentifyResult,
+  ReidConfig,
+  AdaptiveTrackingConfig,
+  AdaptiveTrackingState,
+  ScheduledPipelineResult,
+  PipelineFaceResult,
+  AttributeCacheConfig,
+  MotionGateConfig,
+  CoarseToFineConfig,
+  CoarseToFineResult,
 } from './types';
 
 /**
@@ -66,6 +81,155 @@ export interface Session extends HybridObject<{ ios: 'c++'; android: 'c++' }> {
     faceToken: ArrayBuffer
   ): ArrayBuffer;
 
+  /**
+   * Configure when `extractFaceFeatureCached` extracts a tracked face again.
+   * @param config Cache settings
+   */
+  setFeatureCacheConfig(config: FeatureCacheConfig): void;
+
+  /**
+   * Extract face features from a tracked face, reusing the feature of an earlier frame of the same track.
+   * @param imageStream Input image stream
+   * @param face Face returned by `executeFaceTrack` for this stream
+   */
+  extractFaceFeatureCached(imageStream: ImageStream, face: FaceData): ArrayBuffer;
+
+  /**
+   * Drop all cached track features.
+   */
+  clearFeatureCache(): void;
+
+  /**
+   * Keep the best aligned face crops of every track while `executeFaceTrack` runs.
+   * @param config Best-shot settings
+   * @param onTrackEnd Called with the best frames, best first, once a track is no longer tracked
+   */
+  enableBestShot(
+    config: BestShotConfig,
+    onTrackEnd: (trackId: number, shots: BestShot[]) => void
+  ): void;
+
+  /**
+   * Stop keeping best shots and drop the pending ones.
+   */
+  disableBestShot(): void;
+
+  /**
+   * Emit the best shots of all current tracks right away.
+   */
+  flushBestShots(): void;
+
+  /**
+   * Fuse the features of every track across frames while `executeFaceTrack` runs.
+   * @param config Fusion settings
+   */
+  setTrackFusionConfig(config: TrackFusionConfig): void;
+
+  /**
+   * Get the fused feature of a track.
+   * @param trackId Track ID from `executeFaceTrack`
+   * @returns Quality-weighted mean feature, or null when no frame of the track was fused yet
+   */
+  getTrackFeature(trackId: number): ArrayBuffer | null;
+
+  /**
+   * Track faces, extract their features and search them in the FeatureHub in one call.
+   * @param imageStream Input image stream
+   * @param options Optional identification settings
+   */
+  identify(
+    imageStream: ImageStream,
+    options?: IdentifyOptions
+  ): IdentifyResult[];
+
+  /**
+   * Match new tracks against recently ended ones, so a briefly occluded face keeps its trackId and identity.
+   * @param config Re-identification settings
+   */
+  setReidConfig(config: ReidConfig): void;
+
+  /**
+   * Let the session tune its detect interval and preview size to hold a target frame time.
+   * @param config Controller settings
+   */
+  setAdaptiveTrackingConfig(config: AdaptiveTrackingConfig): void;
+
+  /**
+   * Get the measurements and current settings of the adaptive tracking controller.
+   */
+  getAdaptiveTrackingState(): AdaptiveTrackingState;
+
+  /**
+   * Let `executeFaceTrack` skip tracking and return the previous faces while the scene is static.
+   * Only image streams created from a bitmap are gated. With a region of interest only motion inside it counts,
+   * and moving or resizing the region forces a tracked frame.
+   * @param config Motion gate settings
+   */
+  setMotionGateConfig(config: MotionGateConfig): void;
+
+  /**
+   * Get the motion score of the latest frame seen by the motion gate.
+   * @returns Mean absolute luma difference to the last tracked frame, between 0 and 1
+   */
+  getMotionScore(): number;
+
+  /**
+   * Configure `detectCoarseToFine`, it detects with its own detect-only session.
+   * @param config Coarse-to-fine settings
+   */
+  setCoarseToFineConfig(config: CoarseToFineConfig): void;
+
+  /**
+   * Detect faces in two stages, on a downscaled copy of the frame first and then on full-resolution crops around the candidates.
+   * Faster than a single pass at a high `detectPixelLevel` on large frames with few faces. Tracking state is not touched.
+   * @param imageStream Image stream created from a bitmap, its region of interest is ignored
+   */
+  detectCoarseToFine(imageStream: ImageStream): CoarseToFineResult;
+
+  /**
+   * Set the time budget of a frame, shared by tracking and `scheduledPipelineProcess`.
+   * @param budget Budget in milliseconds, 0 runs every stage on every face
+   */
+  setFrameBudget(budget: number): void;
+
+  /**
+   * Run the enabled pipeline stages on the faces of the latest track call, within the frame budget.
+   * Recognition runs first, the other stages only while budget remains. Skipped stages and faces are tried first on the next frame.
+   * @param imageStream Image stream passed to the latest track call
+   * @param multipleFaceData Faces returned by the latest track call
+   * @param parameter Stages to run, they must be enabled on the session
+   */
+  scheduledPipelineProcess(
+    imageStream: ImageStream,
+    multipleFaceData: FaceData[],
+    parameter: SessionCustomParameter
+  ): ScheduledPipelineResult;
+
+  /**
+   * Configure when `multipleFacePipelineProcessCached` runs a tracked face through the pipeline again.
+   * @param config Cache settings
+   */
+  setAttributeCacheConfig(config: AttributeCacheConfig): void;
+
+  /**
+   * Process multiple faces in a pipeline, reusing the results of earlier frames of the same tracks.
+   * Only new tracks and tracks whose cached results expired are processed.
+   * @param imageStream Input image stream
+   * @param multipleFaceData Faces returned by the latest track call
+   * @param parameter Custom parameters for processing
+   * @returns Results of every face, in the order of the input faces
+   */
+  multipleFacePipelineProcessCached(
+    imageStream: ImageStream,
+    multipleFaceData: FaceData[],
+    parameter: SessionCustomParameter
+  ): PipelineFaceResult[];
+
+  /**
+   * Drop all cached pipeline results.
+   */
+  clearAttributeCache(): void;
+
   /**
    * Get the aligned face image.
    * @param imageStream Input image stream
@@ -76,6 +240,20 @@ export interface Session extends HybridObject<{ ios: 'c++'; android: 'c++' }> {
     faceToken: ArrayBuffer
   ): ImageBitmap;
 
+  /**
+   * Get the aligned images of several faces in one call, packed into an atlas of 112x112 crops.
+   * Face i is written to the cell in column i % columns and row floor(i / columns), cells without a face are black.
+   * @param imageStream Input image stream
+   * @param faceTokens Face token data of every face
+   * @param atlas Optional 3 channel bitmap to write into, its width and height in cells must hold all faces. By default a new, nearly square atlas is created
+   * @returns The atlas holding the aligned faces
+   */
+  getFaceAlignmentImages(
+    imageStream: ImageStream,
+    faceTokens: ArrayBuffer[],
+    atlas?: ImageBitmap
+  ): ImageBitmap;
+
   /**
    * Process multiple faces in a pipeline.
    * @param imageStream Input image stream
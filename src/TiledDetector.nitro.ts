@@ -0,0 +1,22 @@
+import type { HybridObject } from 'react-native-nitro-modules';
+import type { ImageStream } from './ImageStream.nitro';
+import type { DetectedFace } from './types';
+
+/**
+ * Detects small faces in large frames.
+ * The frame is split into overlapping tiles detected at the detector resolution,
+ * optionally in parallel on a pool of sessions, and the results are merged with
+ * non-max suppression.
+ */
+export interface TiledDetector
+  extends HybridObject<{ ios: 'c++'; android: 'c++' }> {
+  /** Number of sessions detecting tiles in parallel */
+  readonly workerCount: number;
+
+  /**
+   * Detect faces tile by tile.
+   * @param imageStream Image stream created from a 3 channel bitmap
+   * @returns Faces in full-frame coordinates, most confident first
+   */
+  detect(imageStream: ImageStream): DetectedFace[];
+}
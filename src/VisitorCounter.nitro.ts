@@ -0,0 +1,40 @@
+import type { HybridObject } from 'react-native-nitro-modules';
+import type { VisitorStats } from './types';
+
+/**
+ * Counts distinct people seen by a camera without a gallery.
+ * Features are clustered online into a bounded set of decaying centroids,
+ * every centroid being one visitor.
+ */
+export interface VisitorCounter
+  extends HybridObject<{ ios: 'c++'; android: 'c++' }> {
+  /** Number of visitors currently held as centroids */
+  readonly centroidCount: number;
+
+  /**
+   * Add a face feature seen at the given time.
+   * @param feature Face feature extracted by `Session.extractFaceFeature`
+   * @param timestamp Time the face was seen, in milliseconds
+   * @returns ID of the visitor the face was matched to
+   */
+  update(feature: ArrayBuffer, timestamp: number): number;
+
+  /**
+   * Count the visitors present at some point of a time window.
+   * @param start Start of the window, in milliseconds
+   * @param end End of the window, in milliseconds
+   */
+  getUniqueCount(start: number, end: number): number;
+
+  /**
+   * Get the visitors present at some point of a time window.
+   * @param start Start of the window, in milliseconds
+   * @param end End of the window, in milliseconds
+   */
+  getVisitors(start: number, end: number): VisitorStats[];
+
+  /**
+   * Forget all visitors.
+   */
+  reset(): void;
+}
@@ -166,3 +166,68 @@ export enum LogLevel {
    */
   FATAL = 5,
 }
+
+/**
+ * Optional pipeline stages run by the frame budget scheduler, in priority order.
+ */
+export enum PipelineStage {
+  /**
+   * Face feature extraction.
+   */
+  RECOGNITION = 0,
+
+  /**
+   * Face quality assessment.
+   */
+  QUALITY = 1,
+
+  /**
+   * RGB liveness detection.
+   */
+  LIVENESS = 2,
+
+  /**
+   * Mask detection.
+   */
+  MASK = 3,
+
+  /**
+   * Face attribute prediction.
+   */
+  ATTRIBUTE = 4,
+}
+
+/**
+ * Resampling used when an image is resized.
+ */
+export enum Interpolation {
+  /**
+   * Nearest pixel, fastest, blocky when enlarging.
+   */
+  NEAREST = 0,
+
+  /**
+   * Bilinear interpolation of the 4 nearest pixels.
+   */
+  BILINEAR = 1,
+
+  /**
+   * Average of the covered pixels, free of aliasing when shrinking.
+   */
+  AREA = 2,
+}
+
+/**
+ * Compressed image format for encoding.
+ */
+export enum ImageEncoding {
+  /**
+   * JPEG, lossy, size controlled by the quality.
+   */
+  JPEG = 0,
+
+  /**
+   * PNG, lossless, keeps the alpha channel.
+   */
+  PNG = 1,
+}
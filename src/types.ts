@@ -1,4 +1,12 @@
-import type { PrimaryKeyMode, SearchMode } from './enums';
+import type {
+  CameraRotation,
+  ImageFormat,
+  Interpolation,
+  PipelineStage,
+  PrimaryKeyMode,
+  SearchMode,
+} from './enums';
+import type { ImageBitmap } from './ImageBitmap.nitro';
 
 /**
  * Custom parameters for configuring a face recognition session.
@@ -42,6 +50,13 @@ export type FeatureHubConfiguration = {
   searchThreshold: number;
   /** Mode for managing primary keys in the database */
   primaryKeyMode: PrimaryKeyMode;
+  /**
+   * In EAGER mode, scan the most frequently matched identities first.
+   * Hit counters are kept per ID and persisted next to the database.
+   */
+  enableFrequencyOrdering?: boolean;
+  /** Number of searches between two reorders of the scan order (default 256) */
+  reorderInterval?: number;
 };
 
 /**
@@ -149,6 +164,62 @@ export type SearchTopKResult = {
   id: number;
 };
 
+/**
+ * Result of re-extracting stale FeatureHub features after a model pack change.
+ */
+export type FeatureMigrationResult = {
+  /** Number of face features re-extracted and swapped into the FeatureHub */
+  migrated: number;
+  /** Number of face features whose crop could not be re-extracted */
+  failed: number;
+  /** Number of stale face features without a stored crop */
+  skipped: number;
+  /** Whether the migration was cancelled before the swap */
+  cancelled: boolean;
+  /** Model pack the features were migrated to */
+  modelTag: string;
+};
+
+/**
+ * Two stored face features more similar than the audit threshold.
+ * Usually the same person enrolled twice.
+ */
+export type GalleryAuditPair = {
+  /** ID of the first face feature */
+  firstId: number;
+  /** ID of the second face feature */
+  secondId: number;
+  /** Cosine similarity of the two features, as returned by `faceComparison` */
+  similarity: number;
+};
+
+/**
+ * Nearest impostor of a stored face feature.
+ * A small or negative margin means searches can return the wrong ID.
+ */
+export type GalleryIdentityMargin = {
+  /** ID of the face feature */
+  id: number;
+  /** ID of the most similar other face feature (the nearest impostor) */
+  nearestId: number;
+  /** Cosine similarity to the nearest impostor */
+  similarity: number;
+  /** Search threshold minus `similarity`, negative when the impostor would be matched */
+  margin: number;
+};
+
+/**
+ * Result of a FeatureHub audit.
+ */
+export type GalleryAuditReport = {
+  /** Pairs at or above the audit threshold, most similar first */
+  pairs: GalleryAuditPair[];
+  /** Nearest impostor of every face feature */
+  margins: GalleryIdentityMargin[];
+  /** Whether the audit was cancelled before finishing */
+  cancelled: boolean;
+};
+
 /**
  * State information for face interaction detection.
  * Used to track the state of eyes during interaction.
@@ -206,3 +277,348 @@ export type SimilarityConverterConfig = {
   /** Maximum output value */
   outputMax: number;
 };
+
+/**
+ * Settings of a face clusterer.
+ */
+export type FaceClustererConfig = {
+  /** Similarity at or above which two faces are linked */
+  threshold: number;
+  /** Optional. Number of nearest neighbors linked per face. Default to 10 */
+  neighborCount?: number;
+  /** Optional. Maximum number of Chinese Whispers iterations. Default to 20 */
+  iterations?: number;
+};
+
+/**
+ * Group of faces that belong to the same person.
+ */
+export type FaceCluster = {
+  /** ID of the cluster */
+  id: number;
+  /** IDs of the faces in the cluster */
+  faceIds: number[];
+  /** ID of the face closest to the cluster center */
+  representativeId: number;
+};
+
+/**
+ * Settings of a visitor counter.
+ */
+export type VisitorCounterConfig = {
+  /** Similarity at or above which a face is matched to a visitor */
+  threshold: number;
+  /** Optional. Maximum number of visitors held as centroids. Default to 256 */
+  maxCentroids?: number;
+  /** Optional. Time in milliseconds after which the weight of a visitor halves. Default to 60000 */
+  halfLife?: number;
+  /** Optional. Time in milliseconds visitors are kept for window queries after they were last seen. Default to 3600000 */
+  retention?: number;
+};
+
+/**
+ * Presence of a visitor.
+ */
+export type VisitorStats = {
+  /** ID of the visitor */
+  id: number;
+  /** Time the visitor was first seen, in milliseconds */
+  firstSeen: number;
+  /** Time the visitor was last seen, in milliseconds */
+  lastSeen: number;
+  /** Time between the first and last sighting, in milliseconds */
+  dwellTime: number;
+  /** Number of faces matched to the visitor */
+  sightings: number;
+};
+
+/**
+ * Settings of the per-track feature cache of a session.
+ */
+export type FeatureCacheConfig = {
+  /** Optional. Time in milliseconds after which a cached feature is extracted again. Default to 2000 */
+  ttl?: number;
+  /** Optional. Face area ratio over the cached face that triggers a new extraction. Default to 1.25 */
+  sizeGrowth?: number;
+  /** Optional. Decrease of |yaw| + |pitch| in degrees that triggers a new extraction. Default to 10 */
+  poseImprovement?: number;
+};
+
+/**
+ * Settings of the per-track pipeline result cache of a session.
+ */
+export type AttributeCacheConfig = {
+  /** Optional. Time in milliseconds after which a track goes through the pipeline again. Default to 5000 */
+  ttl?: number;
+};
+
+/**
+ * Settings of the per-track best-shot selection of a session.
+ */
+export type BestShotConfig = {
+  /** Optional. Number of best frames kept per track. Default to 3 */
+  count?: number;
+  /** Optional. Minimum score for a frame to be kept. Default to 0 */
+  minScore?: number;
+};
+
+/**
+ * One of the best frames of a track.
+ */
+export type BestShot = {
+  /** Combined score of quality, pose and face size, between 0 and 1 */
+  score: number;
+  /** Face quality of the frame */
+  quality: number;
+  /** Face rectangle in the frame */
+  rect: FaceRect;
+  /** Head pose in the frame */
+  angle: FaceEulerAngle;
+  /** Aligned face image */
+  image: ImageBitmap;
+};
+
+/**
+ * Settings of the per-track feature fusion of a session.
+ */
+export type TrackFusionConfig = {
+  /** Extract and fuse the features of tracked faces */
+  enabled: boolean;
+  /** Optional. Extract every n-th frame of a track. Default to 1 */
+  interval?: number;
+  /** Optional. Frames with a lower quality weight are not fused. Default to 0 */
+  minWeight?: number;
+  /** Optional. Milliseconds the fused feature of an ended track stays readable. Default to 1000 */
+  retainFor?: number;
+};
+
+/**
+ * Settings of `Session.identify`.
+ */
+export type IdentifyOptions = {
+  /** Optional. Reuse the identity of tracks that were already matched. Default to true */
+  useTrackCache?: boolean;
+  /** Optional. Number of frames between two searches of an unmatched track. Default to 15 */
+  retryInterval?: number;
+};
+
+/**
+ * Identity of a tracked face.
+ */
+export type IdentifyResult = {
+  /** Rectangle defining the face region */
+  rect: FaceRect;
+  /** Unique identifier for tracking the face across frames */
+  trackId: number;
+  /** ID of the matched face feature, -1 when no stored face is above the search threshold */
+  id: number;
+  /** Confidence of the match */
+  confidence: number;
+  /** Whether the identity was reused from an earlier frame of the track */
+  cached: boolean;
+};
+
+/**
+ * Settings of the re-identification of recently lost tracks.
+ */
+export type ReidConfig = {
+  /** Match new tracks against recently ended ones */
+  enabled: boolean;
+  /** Similarity at or above which a new track continues an ended one */
+  threshold: number;
+  /** Optional. Time in milliseconds an ended track can be continued. Default to 3000 */
+  ttl?: number;
+  /** Optional. Maximum number of ended tracks remembered. Default to 16 */
+  capacity?: number;
+};
+
+/**
+ * Settings of the adaptive tracking controller of a session.
+ */
+export type AdaptiveTrackingConfig = {
+  /** Tune detect interval and preview size on every tracked frame */
+  enabled: boolean;
+  /** Frame time in milliseconds the controller aims for */
+  targetFrameTime: number;
+  /** Optional. Lower bound of the detect interval. Default to 5 */
+  minDetectInterval?: number;
+  /** Optional. Upper bound of the detect interval. Default to 60 */
+  maxDetectInterval?: number;
+  /** Optional. Lower bound of the track preview size in pixels. Default to 128 */
+  minPreviewSize?: number;
+  /** Optional. Upper bound of the track preview size in pixels. Default to 320 */
+  maxPreviewSize?: number;
+};
+
+/**
+ * Measurements and current settings of the adaptive tracking controller.
+ */
+export type AdaptiveTrackingState = {
+  /** Whether the controller is enabled */
+  enabled: boolean;
+  /** Smoothed frame time in milliseconds */
+  frameTime: number;
+  /** Smoothed number of tracked faces */
+  faceCount: number;
+  /** Smoothed number of tracks started or ended per frame */
+  churn: number;
+  /** Detect interval currently applied */
+  detectInterval: number;
+  /** Track preview size currently applied, in pixels */
+  previewSize: number;
+};
+
+/**
+ * Pipeline results for a single face.
+ * A field is only set when its stage was requested and ran on the face or came from the cache.
+ */
+export type PipelineFaceResult = {
+  /** Track ID of the face */
+  trackId: number;
+  /** Face feature */
+  feature?: ArrayBuffer;
+  /** Face quality confidence */
+  quality?: number;
+  /** RGB liveness confidence */
+  liveness?: number;
+  /** Mask confidence */
+  mask?: number;
+  /** Face attributes */
+  attribute?: FaceAttributeResult;
+};
+
+/**
+ * Outcome of a scheduled pipeline call.
+ */
+export type ScheduledPipelineResult = {
+  /** Stages that ran on at least one face, in the order they ran */
+  stages: PipelineStage[];
+  /** Results per face, in the order of the input faces */
+  faces: PipelineFaceResult[];
+  /** Time spent tracking and processing this frame, in milliseconds */
+  frameTime: number;
+};
+
+/**
+ * Settings of the motion gate of a session.
+ */
+export type MotionGateConfig = {
+  /** Skip tracking while the scene is static */
+  enabled: boolean;
+  /** Optional. Motion score under which a frame counts as static. Default to 0.01 */
+  threshold?: number;
+  /** Optional. Static frames skipped in a row before a frame is tracked anyway. Default to 30 */
+  maxSkippedFrames?: number;
+};
+
+/**
+ * Settings of a tiled detector.
+ */
+export type TiledDetectorConfig = {
+  /** Optional. Width and height of a tile in pixels. Default to 640 */
+  tileSize?: number;
+  /** Optional. Fraction of a tile shared with its neighbors, so faces on a border are seen whole. Default to 0.25 */
+  overlap?: number;
+  /** Optional. Number of sessions detecting tiles in parallel. Default to 1 */
+  workerCount?: number;
+  /** Optional. Detection resolution level of every tile. Default to 320 */
+  detectPixelLevel?: number;
+  /** Optional. Maximum number of faces detected per tile. Default to 20 */
+  maxDetectFaceNum?: number;
+  /** Optional. Also detect on the whole frame, for faces larger than a tile. Default to true */
+  includeFullFrame?: boolean;
+  /** Optional. Overlap above which the less confident of two faces is dropped. Default to 0.4 */
+  iouThreshold?: number;
+};
+
+/**
+ * Face found by a detector without tracking.
+ */
+export type DetectedFace = {
+  /** Rectangle defining the face region, in full-frame coordinates */
+  rect: FaceRect;
+  /** Confidence score of the face detection */
+  detConfidence: number;
+  /** 3D orientation of the face */
+  angle: FaceEulerAngle;
+};
+
+/**
+ * Settings of the coarse-to-fine detection of a session.
+ */
+export type CoarseToFineConfig = {
+  /** Run coarse-to-fine detection, false releases its detector */
+  enabled: boolean;
+  /** Optional. Longest side in pixels of the downscaled frame searched for candidates. Default to 320 */
+  coarseSize?: number;
+  /** Optional. Detection resolution level of both stages. Default to 160 */
+  detectPixelLevel?: number;
+  /** Optional. Maximum number of faces detected per stage. Default to 20 */
+  maxDetectFaceNum?: number;
+  /** Optional. Margin added around a candidate before detecting again, as a fraction of its size. Default to 0.5 */
+  margin?: number;
+  /** Optional. Overlap above which the less confident of two faces is dropped. Default to 0.4 */
+  iouThreshold?: number;
+};
+
+/**
+ * Result of a coarse-to-fine detection.
+ */
+export type CoarseToFineResult = {
+  /** Faces confirmed by the fine stage */
+  faces: DetectedFace[];
+  /** Number of candidates found by the coarse stage */
+  candidateCount: number;
+  /** Time spent in the coarse stage, in milliseconds */
+  coarseTime: number;
+  /** Time spent in the fine stage, in milliseconds */
+  fineTime: number;
+};
+
+/**
+ * Crop, rotation, resize and format conversion applied to an image in a single pass.
+ */
+export type ImageTransform = {
+  /** Optional. Region to keep, clamped to the image. Default to the whole image */
+  rect?: FaceRect;
+  /** Optional. Width of the result in pixels, after rotation. Default to the height scaled by the aspect ratio, or the region width */
+  width?: number;
+  /** Optional. Height of the result in pixels, after rotation. Default to the width scaled by the aspect ratio, or the region height */
+  height?: number;
+  /** Optional. Clockwise rotation applied to the region. Default to no rotation, or the stream rotation for an image stream */
+  rotation?: CameraRotation;
+  /** Optional. Pixel format of the result, RGB or BGR with or without alpha. Default to the source layout */
+  format?: ImageFormat;
+  /** Optional. Resampling used when resizing. Default to AREA when shrinking, BILINEAR otherwise */
+  interpolation?: Interpolation;
+};
+
+/**
+ * Pixels of a decoded image, 4 channels in RGBA order.
+ */
+export type DecodedImage = {
+  /** Pixel data, width * height * 4 bytes */
+  data: ArrayBuffer;
+  /** Width of the image in pixels */
+  width: number;
+  /** Height of the image in pixels */
+  height: number;
+};
+
+/**
+ * Look of the tracking results drawn by `ImageBitmap.drawFaces`.
+ */
+export type OverlayStyle = {
+  /** Color of the face rectangles and the background of their labels */
+  color: Color;
+  /** Optional. Line thickness of the rectangles in pixels. Default to 2 */
+  thickness?: number;
+  /** Optional. Color of the landmark points. Default to the rectangle color */
+  pointColor?: Color;
+  /** Optional. Side of the square drawn for every landmark point in pixels. Default to 2 */
+  pointSize?: number;
+  /** Optional. Draw the track ID above every rectangle. Default to true */
+  showTrackId?: boolean;
+  /** Optional. Height of the track ID digits in pixels, rounded to a multiple of 5. Default to 10 */
+  labelSize?: number;
+};